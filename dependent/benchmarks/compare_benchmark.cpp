@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dependent/dependent.h"
+
+// Compares the comparison operators of dependent vectors with the
+// std::equal/std::lexicographical_compare loops they used to run, on the words
+// from test_data/words: sorting, adjacent equality checks and building a set.
+// The words are also run with a long common prefix, where the first mismatch
+// is far from the start.
+
+constexpr std::string_view c_items_separator = "@@@";
+
+class usage_error : public std::exception {
+  std::string msg_;
+
+ public:
+  usage_error(std::string_view executable_name) {
+    msg_ = "Usage error, expceted usage:";
+    msg_ += executable_name;
+    msg_ += " <path_to_strings>\n";
+  }
+  const char* what() const noexcept override { return msg_.c_str(); }
+};
+
+std::vector<std::string> read_words(std::string_view file_name) {
+  std::fstream in(std::string(file_name), std::ios::in);
+
+  std::vector<std::string> res;
+  std::string buffer;
+  std::string element;
+  while (in) {
+    std::getline(in, buffer);
+    if (buffer == c_items_separator) {
+      if (!element.empty()) res.push_back(element);
+      element.clear();
+      continue;
+    }
+    if (buffer.empty()) continue;
+    element += buffer;
+  }
+  return res;
+}
+
+struct scalar_less {
+  template <typename V>
+  bool operator()(const V& x, const V& y) const {
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return std::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
+                                        ys.end());
+  }
+};
+
+struct scalar_equal {
+  template <typename V>
+  bool operator()(const V& x, const V& y) const {
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return std::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+  }
+};
+
+// Best of several runs.
+template <typename F>
+double measure_ms(F f) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < 7; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, d.count());
+  }
+  return best;
+}
+
+template <typename Char>
+void run(const std::vector<std::string>& words, std::string_view name,
+         std::string_view key_prefix = {}) {
+  using alloc_t = std::allocator<Char>;
+  using vec_t = dependent_lib::vector<Char, alloc_t>;
+
+  alloc_t a;
+  std::vector<vec_t> input;
+  std::string key;
+  for (const auto& w : words) {
+    key = key_prefix;
+    key += w;
+    input.emplace_back(std::allocator_arg, a, key.begin(), key.end());
+  }
+
+  std::mt19937 gen(42);
+  std::shuffle(input.begin(), input.end(), gen);
+
+  auto report = [&](std::string_view what, auto scalar, auto kernel) {
+    std::cout << name << " " << what << ": scalar " << measure_ms(scalar)
+              << " ms, kernel " << measure_ms(kernel) << " ms" << std::endl;
+  };
+
+  // Warm up the payloads.
+  std::size_t warm_up = 0;
+  for (const auto& v : input) warm_up += v.as_span().size();
+  if (!warm_up) return;
+
+  std::vector<vec_t> sorted;
+  report("sort",
+         [&] {
+           sorted = input;
+           std::sort(sorted.begin(), sorted.end(), scalar_less{});
+         },
+         [&] {
+           sorted = input;
+           std::sort(sorted.begin(), sorted.end(), std::less<>{});
+         });
+
+  std::size_t eq1 = 0, eq2 = 0;
+  report("adjacent equality",
+         [&] {
+           for (std::size_t j = 1; j < sorted.size(); ++j)
+             eq1 += scalar_equal{}(sorted[j - 1], sorted[j]);
+         },
+         [&] {
+           for (std::size_t j = 1; j < sorted.size(); ++j)
+             eq2 += sorted[j - 1] == sorted[j];
+         });
+
+  std::size_t size1 = 0, size2 = 0;
+  report("set insert",
+         [&] {
+           std::set<vec_t, scalar_less> s(input.begin(), input.end());
+           size1 = s.size();
+         },
+         [&] {
+           std::set<vec_t, std::less<>> s(input.begin(), input.end());
+           size2 = s.size();
+         });
+
+  if (eq1 != eq2 || size1 != size2)
+    throw std::logic_error("kernels disagree with std algorithms");
+
+  for (auto& v : input) v.destroy(a);
+}
+
+int main(int argc, const char* argv[]) {
+  static const usage_error usage_err(argv[0]);
+
+  try {
+    if (argc != 2) throw usage_err;
+
+    auto words = read_words(argv[1]);
+    std::cout << "Words: " << words.size() << std::endl;
+    run<char>(words, "char");
+    run<unsigned char>(words, "unsigned char");
+    run<short>(words, "short");
+
+    // Keys sharing a long prefix, like paths or URLs.
+    constexpr std::string_view prefix =
+        "https://en.wiktionary.org/wiki/dictionary/webster/";
+    run<char>(words, "prefixed char", prefix);
+    run<unsigned char>(words, "prefixed unsigned char", prefix);
+    run<short>(words, "prefixed short", prefix);
+  } catch (const std::exception& e) {
+    std::cout << e.what() << std::endl;
+  }
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "dependent/concurrent_dense_allocator.h"
+#include "dependent/dense_allocator.h"
+
+// Allocation throughput of a dense arena shared by a growing number of
+// threads: concurrent_dense_allocators against dense_allocators behind a
+// mutex.
+
+constexpr std::size_t c_allocations_per_thread = 4'000'000;
+
+// Best of several runs.
+template <typename F>
+double measure_ms(F f) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < 5; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, d.count());
+  }
+  return best;
+}
+
+// Returns the sum of the addresses, so the allocations can't be optimized
+// away. Every thread sums into a slot of its own.
+template <typename Allocate>
+std::uintptr_t run_threads(unsigned thread_count, Allocate allocate) {
+  std::vector<std::uintptr_t> sums(thread_count);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t != thread_count; ++t) {
+    threads.emplace_back([&, t] {
+      std::uintptr_t sum = 0;
+      for (std::size_t i = 0; i != c_allocations_per_thread; ++i) {
+        auto* p = allocate(i % 4 + 1);
+        *p = static_cast<std::int64_t>(i);
+        sum += reinterpret_cast<std::uintptr_t>(p);
+      }
+      sums[t] = sum;
+    });
+  }
+  for (auto& t : threads) t.join();
+  std::uintptr_t res = 0;
+  for (auto sum : sums) res += sum;
+  return res;
+}
+
+void report(std::string_view name, unsigned thread_count, double ms,
+            std::uintptr_t checksum) {
+  const double total = double(c_allocations_per_thread) * thread_count;
+  std::cout << name << " threads " << thread_count << ": "
+            << total / ms / 1000 << " M allocations/s (checksum " << checksum
+            << ")" << std::endl;
+}
+
+int main() {
+  using backing_allocator = std::allocator<std::int64_t>;
+  using concurrent_t =
+      dependent_lib::concurrent_dense_allocators<backing_allocator,
+                                                 std::int64_t>;
+  using locked_t =
+      dependent_lib::dense_allocators<backing_allocator, std::int64_t>;
+
+  const unsigned max_threads =
+      std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+    std::uintptr_t checksum = 0;
+    double concurrent_ms = measure_ms([&] {
+      concurrent_t arena(backing_allocator{});
+      dependent_lib::dense_allocator_handler<std::int64_t, concurrent_t> a(
+          &arena);
+      checksum +=
+          run_threads(threads, [&](std::size_t n) { return a.allocate(n); });
+    });
+    report("concurrent_dense_allocators", threads, concurrent_ms, checksum);
+
+    checksum = 0;
+    double locked_ms = measure_ms([&] {
+      locked_t arena(backing_allocator{});
+      dependent_lib::dense_allocator_handler<std::int64_t, locked_t> a(&arena);
+      std::mutex m;
+      checksum += run_threads(threads, [&](std::size_t n) {
+        std::lock_guard<std::mutex> lock(m);
+        return a.allocate(n);
+      });
+    });
+    report("dense_allocators with a mutex", threads, locked_ms, checksum);
+  }
+}
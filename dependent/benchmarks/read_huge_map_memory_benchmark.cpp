@@ -1,10 +1,16 @@
+#include <algorithm>
+#include <chrono>
 #include <experimental/string_view>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <unordered_set>
+#include <vector>
 
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
 #include "dependent/utils/stats_allocator.h"
 #include "dependent/utils/stats_containers.h"
 
@@ -46,6 +52,61 @@ void read_into_container(std::string_view file_name, Container* container) {
   }
 }
 
+std::vector<std::string> read_words(std::string_view file_name) {
+  std::fstream in(std::string(file_name), std::ios::in);
+
+  std::vector<std::string> res;
+  std::string buffer;
+  std::string element;
+  while (in) {
+    std::getline(in, buffer);
+    if (buffer == c_items_separator) {
+      if (!element.empty()) res.push_back(element);
+      element.clear();
+      continue;
+    }
+    if (buffer.empty()) continue;
+    element += buffer;
+  }
+  return res;
+}
+
+// Loads the words as dependent vectors into an arena with the given policy.
+// The arena's blocks are allocated with a stats_allocator tagged with the
+// policy, so the reported size is what the arena took from the system.
+template <typename Policy>
+void load_into_arena(const std::vector<std::string>& words,
+                     std::string_view name) {
+  using backing_allocator = dependent::stats_allocator<char, Policy>;
+  using arena_t = dependent_lib::basic_dense_allocators<
+      Policy, backing_allocator, char,
+      dependent_lib::unknown_type<sizeof(void*), alignof(void*)>>;
+  using vec_t = dependent_lib::vector<
+      char, dependent_lib::allocator_adaptor<
+                dependent_lib::dense_allocator_handler<char, arena_t>>>;
+  using outer_allocator = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<vec_t, arena_t>>;
+
+  double best = std::numeric_limits<double>::max();
+  std::size_t allocated = 0;
+  for (int i = 0; i < 5; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    {
+      arena_t arena{backing_allocator{}};
+      std::vector<vec_t, outer_allocator> dict(outer_allocator{&arena});
+      dict.reserve(words.size());
+      for (const auto& w : words) dict.emplace_back(w);
+      allocated = dependent::area_stats<Policy>::total_allocated_size();
+    }
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, d.count());
+  }
+
+  std::cout << name << ": allocated size " << allocated << ", load " << best
+            << " ms" << std::endl;
+}
+
 int main(int argc, const char* argv[]) {
   static const usage_error usage_err(argv[0]);
 
@@ -60,6 +121,12 @@ int main(int argc, const char* argv[]) {
               << dependent::area_stats<tag>::total_allocated_size()
               << std::endl;
 
+    auto words = read_words(argv[1]);
+    load_into_arena<dependent_lib::default_dense_policy>(
+        words, "Arena, 4 KiB blocks");
+    load_into_arena<dependent_lib::growing_dense_policy>(
+        words, "Arena, 4 KiB to 2 MiB blocks");
+
   } catch (const std::exception& e) {
     std::cout << e.what() << std::endl;
   }
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dependent/dependent.h"
+#include "dependent/string_handle.h"
+
+// Compares the 16 byte string_handle with the 8 byte dependent vector on the
+// words from test_data/words: sorting, building a set and looking every word
+// up in it. The words are also run with a long common prefix.
+
+constexpr std::string_view c_items_separator = "@@@";
+
+class usage_error : public std::exception {
+  std::string msg_;
+
+ public:
+  usage_error(std::string_view executable_name) {
+    msg_ = "Usage error, expceted usage:";
+    msg_ += executable_name;
+    msg_ += " <path_to_strings>\n";
+  }
+  const char* what() const noexcept override { return msg_.c_str(); }
+};
+
+std::vector<std::string> read_words(std::string_view file_name) {
+  std::fstream in(std::string(file_name), std::ios::in);
+
+  std::vector<std::string> res;
+  std::string buffer;
+  std::string element;
+  while (in) {
+    std::getline(in, buffer);
+    if (buffer == c_items_separator) {
+      if (!element.empty()) res.push_back(element);
+      element.clear();
+      continue;
+    }
+    if (buffer.empty()) continue;
+    element += buffer;
+  }
+  return res;
+}
+
+// Best of several runs.
+template <typename F>
+double measure_ms(F f) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < 7; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, d.count());
+  }
+  return best;
+}
+
+template <typename Str>
+std::vector<Str> make_input(const std::vector<std::string>& words,
+                            std::string_view key_prefix) {
+  std::allocator<char> a;
+  std::vector<Str> res;
+  std::string key;
+  for (const auto& w : words) {
+    key = key_prefix;
+    key += w;
+    res.emplace_back(std::allocator_arg, a, key.begin(), key.end());
+  }
+  std::mt19937 gen(42);
+  std::shuffle(res.begin(), res.end(), gen);
+  return res;
+}
+
+template <typename Str>
+void run(const std::vector<std::string>& words, std::string_view name,
+         std::string_view key_prefix) {
+  auto input = make_input<Str>(words, key_prefix);
+
+  std::vector<Str> sorted;
+  double sort_ms = measure_ms([&] {
+    sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+  });
+
+  std::size_t found = 0;
+  std::set<Str, std::less<>> s;
+  double insert_ms = measure_ms([&] {
+    s.clear();
+    s.insert(input.begin(), input.end());
+  });
+  double find_ms = measure_ms([&] {
+    found = 0;
+    for (const auto& v : input) found += s.count(v);
+  });
+
+  if (found != s.size() || !std::is_sorted(sorted.begin(), sorted.end()))
+    throw std::logic_error("unexpected result");
+
+  std::cout << name << " (" << sizeof(Str) << " bytes): sort " << sort_ms
+            << " ms, set insert " << insert_ms << " ms, set find " << find_ms
+            << " ms" << std::endl;
+
+  std::allocator<char> a;
+  for (auto& v : input) v.destroy(a);
+}
+
+void run_all(const std::vector<std::string>& words, std::string_view name,
+             std::string_view key_prefix = {}) {
+  using alloc_t = std::allocator<char>;
+  run<dependent_lib::vector<char, alloc_t>>(words,
+                                            std::string(name) + " vector",
+                                            key_prefix);
+  run<dependent_lib::string_handle<char, alloc_t>>(
+      words, std::string(name) + " string_handle", key_prefix);
+}
+
+int main(int argc, const char* argv[]) {
+  static const usage_error usage_err(argv[0]);
+
+  try {
+    if (argc != 2) throw usage_err;
+
+    auto words = read_words(argv[1]);
+    std::cout << "Words: " << words.size() << std::endl;
+    run_all(words, "words");
+
+    // Keys sharing a long prefix, like paths or URLs.
+    run_all(words, "prefixed words",
+            "https://en.wiktionary.org/wiki/dictionary/webster/");
+  } catch (const std::exception& e) {
+    std::cout << e.what() << std::endl;
+  }
+}
@@ -0,0 +1,224 @@
+#ifndef _DEPENDENT_LIB_COMPACTION_H_
+#define _DEPENDENT_LIB_COMPACTION_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
+
+// Compaction and relayout of dependent vectors in dense_allocators.
+//
+// A vector is a single pointer to a payload that knows its own size, so the
+// payload can be copied anywhere and the handle patched. compact<T>() starts
+// the single allocator of T over with no blocks, copies every payload of a
+// vector<T> found in a range densely into fresh blocks, and releases the old
+// blocks with everything dead in them.
+//
+// The range is walked through its elements: vectors, pairs (map entries) and
+// vectors of vectors. Vector keys of sets and maps are patched in place,
+// which keeps them equal. Nodes of the containers themselves have to live in
+// another single allocator than T, which they do unless they have the same
+// size and alignment.
+//
+// relayout() rebuilds a whole associative container, nodes and payloads,
+// into fresh blocks in iteration order, or hottest first, so scans read
+// memory sequentially.
+//
+// clone() copies a whole arena block by block and points a copy of the
+// vectors at the copied payloads, so a copy costs a memcpy of the blocks
+// and a walk over the vectors instead of an allocation per payload.
+
+namespace dependent_lib {
+
+namespace detail {
+
+template <typename T>
+struct is_dependent_vector : std::false_type {};
+
+template <typename T, typename Alloc, typename Header>
+struct is_dependent_vector<vector<T, Alloc, Header>> : std::true_type {};
+
+template <typename T>
+struct is_pair : std::false_type {};
+
+template <typename T, typename U>
+struct is_pair<std::pair<T, U>> : std::true_type {};
+
+// Whether the container X takes its allocator from an Arena*, i.e. its
+// nodes live in the arena.
+template <typename X, typename Arena, typename = void>
+struct allocates_in : std::false_type {};
+
+template <typename X, typename Arena>
+struct allocates_in<X, Arena, std::void_t<typename X::allocator_type>>
+    : std::is_constructible<typename X::allocator_type, Arena*> {};
+
+template <typename X, typename Relocate>
+void visit_dependent(X& x, Relocate& relocate) {
+  using type = std::remove_const_t<X>;
+  auto& y = const_cast<type&>(x);
+  if constexpr (is_dependent_vector<type>::value) {
+    relocate(y);
+    using element = typename type::value_type;
+    if constexpr (is_dependent_vector<element>::value ||
+                  is_pair<element>::value) {
+      y.update_elements([&](element& e) { visit_dependent(e, relocate); });
+    }
+  } else if constexpr (is_pair<type>::value) {
+    visit_dependent(y.first, relocate);
+    visit_dependent(y.second, relocate);
+  }
+}
+
+// Vectors are copied from their elements, everything else as is.
+template <typename X>
+decltype(auto) relayout_arg(const X& x) noexcept {
+  if constexpr (is_dependent_vector<X>::value) {
+    return x.as_span();
+  } else {
+    return (x);
+  }
+}
+
+template <typename Container, typename Hint, typename X>
+void relayout_emplace(Container& c, Hint hint, const X& x) {
+  if constexpr (is_pair<X>::value) {
+    c.emplace_hint(hint, relayout_arg(x.first), relayout_arg(x.second));
+  } else {
+    c.emplace_hint(hint, relayout_arg(x));
+  }
+}
+
+// Detaches the blocks of an arena, or of a single allocator, and takes them
+// back if copying out of them throws half way: then every element still
+// points to memory the arena owns. release() frees them once nothing does.
+template <typename Arena>
+class detached_blocks_guard {
+  Arena& arena_;
+  decltype(std::declval<Arena&>().detach_blocks()) blocks_;
+  bool released_ = false;
+
+ public:
+  explicit detached_blocks_guard(Arena& arena)
+      : arena_(arena), blocks_(arena.detach_blocks()) {}
+
+  detached_blocks_guard(const detached_blocks_guard&) = delete;
+  detached_blocks_guard& operator=(const detached_blocks_guard&) = delete;
+
+  ~detached_blocks_guard() {
+    if (!released_) arena_.reattach_blocks(blocks_);
+  }
+
+  void release() noexcept {
+    arena_.release_blocks(blocks_);
+    released_ = true;
+  }
+};
+
+}  // namespace detail
+
+// Every live allocation of the single allocator for T (and for any other
+// type with the same size and alignment) has to be the payload of a vector
+// reachable from r. Payloads too big for a block stay where they are.
+// Returns the number of bytes of blocks given back. If an allocation throws,
+// the vectors moved so far stay moved and the old blocks are kept.
+template <typename T, typename DenseAllocators, typename Range>
+std::size_t compact(DenseAllocators& arena, Range& r) {
+  auto& single =
+      arena.template as_allocator_for_T<sizeof(T), alignof(T)>();
+  using single_type = std::remove_reference_t<decltype(single)>;
+  const auto before = single.stats().block_bytes;
+
+  detail::detached_blocks_guard<single_type> old_blocks(single);
+  auto relocate = [&](auto& v) {
+    using vec_t = std::remove_reference_t<decltype(v)>;
+    using value_type = typename vec_t::value_type;
+    if constexpr (sizeof(value_type) == sizeof(T) &&
+                  alignof(value_type) == alignof(T) &&
+                  std::is_constructible<typename vec_t::allocator_type,
+                                        DenseAllocators*>::value) {
+      if (!single_type::is_large(v.allocation_size()))
+        v.relocate(typename vec_t::allocator_type(&arena));
+    }
+  };
+  for (auto& x : r) detail::visit_dependent(x, relocate);
+  old_blocks.release();
+
+  const auto after = single.stats().block_bytes;
+  return before > after ? before - after : 0;
+}
+
+// Rebuilds the associative container c (a set or a map of dependent
+// vectors) into fresh blocks of arena, in iteration order, and releases the
+// old blocks. Everything else allocated in the arena's blocks is lost.
+// Returns the number of bytes of blocks given back. If an allocation throws,
+// c is left as it was and the old blocks are kept.
+template <typename DenseAllocators, typename Container>
+std::size_t relayout(DenseAllocators& arena, Container& c) {
+  return relayout(arena, c, [](const auto&) { return 0; });
+}
+
+// Same, hottest elements first: hotness(element) returns an access count.
+// Equally hot elements keep their iteration order.
+template <typename DenseAllocators, typename Container, typename Hotness>
+std::size_t relayout(DenseAllocators& arena, Container& c, Hotness hotness) {
+  using element = typename Container::value_type;
+  std::vector<std::pair<decltype(hotness(*c.begin())), const element*>> order;
+  order.reserve(c.size());
+  for (const auto& x : c) order.emplace_back(hotness(x), &x);
+  std::stable_sort(order.begin(), order.end(),
+                   [](const auto& x, const auto& y) {
+                     return x.first > y.first;
+                   });
+
+  const auto before = arena.total_stats().block_bytes;
+  detail::detached_blocks_guard<DenseAllocators> old_blocks(arena);
+  {
+    Container fresh(c.get_allocator());
+    for (const auto& x : order) {
+      // The hint is right for elements in iteration order.
+      detail::relayout_emplace(fresh, fresh.end(), *x.second);
+    }
+    c.swap(fresh);
+    // The old elements go here, while their blocks are still there.
+  }
+  old_blocks.release();
+
+  const auto after = arena.total_stats().block_bytes;
+  return before > after ? before - after : 0;
+}
+
+// Copies the blocks of from into to, which has to be empty, and returns a
+// copy of x pointing into them. x is a dependent vector, a pair, or a range
+// of them (vectors of vectors included) that lives outside of the arena,
+// like a std::map with the default allocator: container nodes can't be
+// moved by memcpy, only the vectors in them are patched. Containers with an
+// allocator made from the arena are rejected at compile time.
+template <typename DenseAllocators, typename X>
+X clone(const DenseAllocators& from, DenseAllocators& to, const X& x) {
+  static_assert(detail::is_dependent_vector<X>::value ||
+                    detail::is_pair<X>::value ||
+                    !detail::allocates_in<X, DenseAllocators>::value,
+                "clone() patches the vectors in a container, not its nodes: "
+                "the nodes must live outside of the arena");
+  const auto relocations = to.clone_from(from);
+  auto rebase = [&](auto& v) {
+    v.rebase([&](auto p) { return relocations(p); });
+  };
+  X res(x);
+  if constexpr (detail::is_dependent_vector<X>::value ||
+                detail::is_pair<X>::value) {
+    detail::visit_dependent(res, rebase);
+  } else {
+    for (auto& y : res) detail::visit_dependent(y, rebase);
+  }
+  return res;
+}
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_COMPACTION_H_
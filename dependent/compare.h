@@ -0,0 +1,144 @@
+#ifndef _DEPENDENT_LIB_COMPARE_H_
+#define _DEPENDENT_LIB_COMPARE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Equality and lexicographical comparison of [f, l) ranges that give the same
+// results as std::equal and std::lexicographical_compare.
+//
+// Integral elements are compared as memory: equality is a memcmp, ordering of
+// unsigned bytes is a memcmp too. Other integrals find the first differing
+// byte with SSE2/AVX2 (when the target has them) and compare that element.
+
+namespace dependent_lib {
+
+namespace detail {
+
+// Elements that are equal iff their bytes are equal.
+template <typename T>
+constexpr bool bitwise_equality_comparable =
+    std::is_integral<T>::value || std::is_same<T, std::byte>::value;
+
+// Elements ordered like memcmp orders their bytes.
+template <typename T>
+constexpr bool bitwise_ordered =
+    sizeof(T) == 1 && (std::is_unsigned<T>::value ||
+                       std::is_same<T, std::byte>::value);
+
+// Offset of the first byte that differs in x and y, n if there is none.
+inline std::size_t mismatch_bytes(const unsigned char* x,
+                                  const unsigned char* y,
+                                  std::size_t n) noexcept {
+  std::size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    __m256i a, b;
+    std::memcpy(&a, x + i, sizeof(a));
+    std::memcpy(&b, y + i, sizeof(b));
+    auto m = ~static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+    if (m) return i + __builtin_ctz(m);
+  }
+#endif
+#ifdef __SSE2__
+  for (; i + 16 <= n; i += 16) {
+    __m128i a, b;
+    std::memcpy(&a, x + i, sizeof(a));
+    std::memcpy(&b, y + i, sizeof(b));
+    auto m = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) &
+             0xffffu;
+    if (m) return i + __builtin_ctz(m);
+  }
+#endif
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; i + 8 <= n; i += 8) {
+    uint64_t a, b;
+    std::memcpy(&a, x + i, 8);
+    std::memcpy(&b, y + i, 8);
+    if (a != b) return i + __builtin_ctzll(a ^ b) / 8;
+  }
+  if (i + 4 <= n) {
+    uint32_t a, b;
+    std::memcpy(&a, x + i, 4);
+    std::memcpy(&b, y + i, 4);
+    if (a != b) return i + __builtin_ctz(a ^ b) / 8;
+    i += 4;
+  }
+#endif
+  for (; i < n; ++i) {
+    if (x[i] != y[i]) return i;
+  }
+  return n;
+}
+
+template <typename T>
+bool equal(const T* xf, const T* xl, const T* yf, const T* yl) noexcept {
+  if constexpr (bitwise_equality_comparable<T>) {
+    const std::size_t n = xl - xf;
+    if (n != static_cast<std::size_t>(yl - yf)) return false;
+    return n == 0 || std::memcmp(xf, yf, n * sizeof(T)) == 0;
+  } else {
+    return std::equal(xf, xl, yf, yl);
+  }
+}
+
+template <typename T>
+bool lexicographical_compare(const T* xf, const T* xl, const T* yf,
+                             const T* yl) noexcept {
+  const std::size_t xn = xl - xf;
+  const std::size_t yn = yl - yf;
+  const std::size_t n = std::min(xn, yn);
+
+  if constexpr (bitwise_ordered<T>) {
+    int res = n ? std::memcmp(xf, yf, n) : 0;
+    return res ? res < 0 : xn < yn;
+  } else if constexpr (bitwise_equality_comparable<T>) {
+    // Most keys differ early: a plain loop over the first 16 bytes is
+    // cheaper than setting up the wide kernel.
+    constexpr std::size_t head = 16 / sizeof(T);
+    std::size_t i = 0;
+    for (; i != n && i != head; ++i) {
+      if (xf[i] != yf[i]) return xf[i] < yf[i];
+    }
+    if (i != n) {
+      i += mismatch_bytes(reinterpret_cast<const unsigned char*>(xf + i),
+                          reinterpret_cast<const unsigned char*>(yf + i),
+                          (n - i) * sizeof(T)) /
+           sizeof(T);
+      if (i != n) return xf[i] < yf[i];
+    }
+    return xn < yn;
+  } else {
+    return std::lexicographical_compare(xf, xl, yf, yl);
+  }
+}
+
+// Ranges of different element types.
+template <typename T, typename U>
+bool equal(const T* xf, const T* xl, const U* yf, const U* yl) {
+  return std::equal(xf, xl, yf, yl);
+}
+
+template <typename T, typename U>
+bool lexicographical_compare(const T* xf, const T* xl, const U* yf,
+                             const U* yl) {
+  return std::lexicographical_compare(xf, xl, yf, yl);
+}
+
+}  // namespace detail
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_COMPARE_H_
@@ -0,0 +1,304 @@
+#ifndef _DEPENDENT_LIB_CONCURRENT_DENSE_ALLOCATOR_H_
+#define _DEPENDENT_LIB_CONCURRENT_DENSE_ALLOCATOR_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "dependent/dense_allocator.h"
+
+// Dense allocators that can be used from many threads at once, through the
+// same dense_allocator_handler.
+//
+// Every thread bumps in a block of its own. Exhausted blocks are replaced
+// from a shared lock-free stack of fresh blocks; only refilling that stack
+// and large allocations take a lock, so the backing allocator doesn't have to
+// be thread safe.
+//
+// Blocks are Policy::block_size bytes, block_growth is ignored. Freed memory
+// isn't reused, except for the most recent allocation of the calling thread.
+
+namespace dependent_lib {
+
+namespace detail {
+
+// Arenas are told apart by ids that are never reused, so a thread never
+// mistakes a destroyed arena for a new one at the same address.
+inline std::uint64_t next_concurrent_arena_id() noexcept {
+  static std::atomic<std::uint64_t> last_id{0};
+  return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+struct concurrent_block_header {
+  // All the blocks of the arena, guarded by its mutex.
+  concurrent_block_header* next_owned;
+  // Blocks waiting in the shared stack. Written only before the block is
+  // pushed, and a block is pushed once.
+  concurrent_block_header* next_free;
+  std::size_t pages;
+};
+
+template <std::size_t sizeof_T, std::size_t alignof_T,
+          typename BackingAllocator, typename Policy = default_dense_policy>
+class single_concurrent_dense_allocator {
+  static_assert(!Policy::reuse_freed,
+                "concurrent dense allocators don't have free lists");
+  static_assert(sizeof(concurrent_block_header) <= cache_line_size, "");
+
+  using cage = std::aligned_storage_t<sizeof_T, alignof_T>;
+
+  static constexpr std::size_t header_space = block_header_space<alignof_T>;
+
+  static constexpr std::size_t cages_in(std::size_t pages) noexcept {
+    return (pages * page_size - header_space) / sizeof_T;
+  }
+
+  static constexpr std::size_t pages_for(std::size_t cages) noexcept {
+    return (header_space + cages * sizeof_T + page_size - 1) / page_size;
+  }
+
+  static constexpr std::size_t block_pages =
+      std::max(Policy::block_size / page_size, pages_for(1));
+  static constexpr std::size_t block_cages = cages_in(block_pages);
+
+  // Blocks taken from the backing allocator under one lock.
+  static constexpr std::size_t refill_blocks = 8;
+  // Arenas a thread keeps a region in. The least recently added one loses
+  // the rest of its block.
+  static constexpr std::size_t regions_per_thread = 4;
+
+  using alloc_traits = std::allocator_traits<BackingAllocator>;
+  using page_allocator =
+      typename alloc_traits::template rebind_alloc<memory_page>;
+  using page_alloc_traits = std::allocator_traits<page_allocator>;
+
+  struct thread_region {
+    std::uint64_t arena_id = 0;
+    cage* begin = nullptr;
+    cage* tail = nullptr;
+    cage* end = nullptr;
+  };
+
+  const std::uint64_t id_ = next_concurrent_arena_id();
+  page_allocator backing_allocator_;
+  // Guards the backing allocator, the owned blocks and the large
+  // allocations. Shared by all the sizes of an arena.
+  std::mutex& mutex_;
+  concurrent_block_header* owned_blocks_ = nullptr;
+  std::atomic<concurrent_block_header*> free_blocks_{nullptr};
+  large_allocation_header* large_allocations_ = nullptr;
+
+  struct thread_regions {
+    std::array<thread_region, regions_per_thread> regions{};
+    std::size_t next_victim = 0;
+  };
+
+  static thread_regions& regions_of_thread() noexcept {
+    thread_local thread_regions res;
+    return res;
+  }
+
+  // The region of the calling thread in this arena, nullptr if it has none.
+  thread_region* find_region() noexcept {
+    for (auto& r : regions_of_thread().regions) {
+      if (r.arena_id == id_) return &r;
+    }
+    return nullptr;
+  }
+
+  // Like find_region(), but takes a region from another arena on a miss.
+  thread_region& region() noexcept {
+    if (auto* r = find_region()) return *r;
+    auto& t = regions_of_thread();
+    auto& r = t.regions[t.next_victim++ % regions_per_thread];
+    r = thread_region{};
+    r.arena_id = id_;
+    return r;
+  }
+
+  static cage* cages_of(concurrent_block_header* block) noexcept {
+    return reinterpret_cast<cage*>(reinterpret_cast<unsigned char*>(block) +
+                                   header_space);
+  }
+
+  // Blocks are never pushed back, so the stack has no ABA problem.
+  concurrent_block_header* pop_block() noexcept {
+    auto* head = free_blocks_.load(std::memory_order_acquire);
+    while (head && !free_blocks_.compare_exchange_weak(
+                       head, head->next_free, std::memory_order_acquire,
+                       std::memory_order_acquire)) {
+    }
+    return head;
+  }
+
+  concurrent_block_header* refill() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Another thread may have refilled while this one waited.
+    if (auto* block = pop_block()) return block;
+
+    concurrent_block_header* first = nullptr;
+    concurrent_block_header* last = nullptr;
+    for (std::size_t i = 0; i != refill_blocks; ++i) {
+      memory_page* pages =
+          &*page_alloc_traits::allocate(backing_allocator_, block_pages);
+      auto* block = ::new (static_cast<void*>(pages))
+          concurrent_block_header{owned_blocks_, first, block_pages};
+      owned_blocks_ = block;
+      if (!last) last = block;
+      first = block;
+    }
+
+    // The first block is for the caller, the others go to the stack.
+    if (first == last) return first;
+    auto* head = free_blocks_.load(std::memory_order_relaxed);
+    do {
+      last->next_free = head;
+    } while (!free_blocks_.compare_exchange_weak(head, first->next_free,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    return first;
+  }
+
+  void* allocate_large(std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto pages = pages_for(size);
+    void* memory = &*page_alloc_traits::allocate(backing_allocator_, pages);
+    auto* header = ::new (memory)
+        large_allocation_header{nullptr, large_allocations_, pages, 0};
+    if (large_allocations_) large_allocations_->prev = header;
+    large_allocations_ = header;
+    return cages_of(reinterpret_cast<concurrent_block_header*>(memory));
+  }
+
+  static large_allocation_header* large_header_of(void* p) noexcept {
+    return reinterpret_cast<large_allocation_header*>(
+        static_cast<unsigned char*>(p) - header_space);
+  }
+
+  void deallocate_large(void* p) noexcept {
+    auto* header = large_header_of(p);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header->prev) {
+      header->prev->next = header->next;
+    } else {
+      large_allocations_ = header->next;
+    }
+    if (header->next) header->next->prev = header->prev;
+    page_alloc_traits::deallocate(backing_allocator_,
+                                  reinterpret_cast<memory_page*>(header),
+                                  header->pages);
+  }
+
+ public:
+  single_concurrent_dense_allocator(const BackingAllocator& alloc,
+                                    std::mutex& mutex)
+      : backing_allocator_(alloc), mutex_(mutex) {}
+
+  single_concurrent_dense_allocator(const single_concurrent_dense_allocator&) =
+      delete;
+  single_concurrent_dense_allocator& operator=(
+      const single_concurrent_dense_allocator&) = delete;
+
+  // No thread may use the arena anymore.
+  ~single_concurrent_dense_allocator() {
+    while (owned_blocks_) {
+      auto* block = owned_blocks_;
+      owned_blocks_ = block->next_owned;
+      page_alloc_traits::deallocate(backing_allocator_,
+                                    reinterpret_cast<memory_page*>(block),
+                                    block->pages);
+    }
+    while (large_allocations_) {
+      auto* header = large_allocations_;
+      large_allocations_ = header->next;
+      page_alloc_traits::deallocate(backing_allocator_,
+                                    reinterpret_cast<memory_page*>(header),
+                                    header->pages);
+    }
+  }
+
+  void* allocate(std::size_t size) {
+    if (size > block_cages) return allocate_large(size);
+    auto& r = region();
+    if (r.end - r.tail < static_cast<std::ptrdiff_t>(size)) {
+      auto* block = pop_block();
+      if (!block) block = refill();
+      r.begin = r.tail = cages_of(block);
+      r.end = r.begin + cages_in(block->pages);
+    }
+    auto* res = r.tail;
+    r.tail += size;
+    return res;
+  }
+
+  // Grows or shrinks the most recent allocation of the calling thread if it
+  // still fits in its block, or a large allocation if it still fits in its
+  // pages. Sizes are in cages.
+  bool try_expand(void* p, std::size_t old_size, std::size_t new_size) {
+    if (old_size > block_cages) {
+      return new_size > block_cages &&
+             new_size <= cages_in(large_header_of(p)->pages);
+    }
+    auto* ptr = static_cast<cage*>(p);
+    auto* r = find_region();
+    if (!r || ptr < r->begin || ptr + old_size != r->tail) return false;
+    if (r->end - ptr < static_cast<std::ptrdiff_t>(new_size)) return false;
+    r->tail = ptr + new_size;
+    return true;
+  }
+
+  // The most recent allocation of the calling thread is given back to its
+  // block, large allocations are released.
+  void deallocate(void* p, std::size_t size) {
+    if (size > block_cages) {
+      deallocate_large(p);
+      return;
+    }
+    auto* ptr = static_cast<cage*>(p);
+    auto* r = find_region();
+    if (r && ptr >= r->begin && ptr + size == r->tail) r->tail = ptr;
+  }
+};
+
+// A base, so the mutex is constructed before the allocators that use it.
+struct concurrent_arena_mutex {
+  std::mutex backing_mutex_;
+};
+
+}  // namespace detail
+
+template <typename Policy, typename Alloc, typename... Ts>
+struct basic_concurrent_dense_allocators
+    : private detail::concurrent_arena_mutex,
+      detail::single_concurrent_dense_allocator<sizeof(Ts), alignof(Ts), Alloc,
+                                                Policy>... {
+  using policy_type = Policy;
+  using backing_allocator_type = Alloc;
+  using alloc_traits = std::allocator_traits<backing_allocator_type>;
+  using pointer = typename alloc_traits::pointer;
+
+  template <std::size_t size, std::size_t alignment>
+  detail::single_concurrent_dense_allocator<size, alignment,
+                                            backing_allocator_type, Policy>&
+  as_allocator_for_T() {
+    return *this;
+  }
+
+  basic_concurrent_dense_allocators(const backing_allocator_type& a)
+      : detail::single_concurrent_dense_allocator<sizeof(Ts), alignof(Ts),
+                                                  backing_allocator_type,
+                                                  Policy>(
+            a, backing_mutex_)... {}
+};
+
+template <typename Alloc, typename... Ts>
+using concurrent_dense_allocators =
+    basic_concurrent_dense_allocators<default_dense_policy, Alloc, Ts...>;
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_CONCURRENT_DENSE_ALLOCATOR_H_
@@ -1,36 +1,294 @@
+#ifndef _DEPENDENT_LIB_DENSE_ALLOCATOR_H_
+#define _DEPENDENT_LIB_DENSE_ALLOCATOR_H_
+
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cinttypes>
-#include <forward_list>
+#include <cstring>
 #include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace dependent_lib {
 
+// Compile time options of dense_allocators. To change some of them derive
+// from default_dense_policy and hide the members.
+struct default_dense_policy {
+  // Keep freed memory in per size class free lists and reuse it. Otherwise
+  // only the most recent allocation is given back.
+  static constexpr bool reuse_freed = false;
+
+  // Size of the first block in bytes. Each next block is block_growth times
+  // bigger, up to max_block_size. Blocks are whole pages and start with a
+  // cache line sized header.
+  static constexpr std::size_t block_size = 4096;
+  static constexpr std::size_t block_growth = 1;
+  static constexpr std::size_t max_block_size = 4096;
+
+  // Allocations that don't fit in max_block_size get pages of their own and
+  // give them back to the backing allocator when they're deallocated. Up to
+  // large_cache_size bytes of them are kept for the next large allocations
+  // instead.
+  static constexpr std::size_t large_cache_size = 0;
+};
+
+struct reusing_dense_policy : default_dense_policy {
+  static constexpr bool reuse_freed = true;
+};
+
+// Blocks double from 4 KiB to 2 MiB: small arenas stay small, big ones are
+// made of few blocks.
+struct growing_dense_policy : default_dense_policy {
+  static constexpr std::size_t block_growth = 2;
+  static constexpr std::size_t max_block_size = 2 << 20;
+};
+
+// Memory of a single dense allocator. Sizes are in bytes; block_bytes and
+// large_bytes include the headers.
+struct dense_allocator_stats {
+  std::size_t blocks = 0;
+  std::size_t block_bytes = 0;
+  // Handed out from blocks and not given back.
+  std::size_t used_bytes = 0;
+  // Left at the end of blocks when an allocation didn't fit.
+  std::size_t tail_waste_bytes = 0;
+  std::size_t free_list_bytes = 0;
+  std::size_t large_allocations = 0;
+  std::size_t large_bytes = 0;
+  std::size_t large_cache_bytes = 0;
+
+  dense_allocator_stats& operator+=(const dense_allocator_stats& x) noexcept {
+    blocks += x.blocks;
+    block_bytes += x.block_bytes;
+    used_bytes += x.used_bytes;
+    tail_waste_bytes += x.tail_waste_bytes;
+    free_list_bytes += x.free_list_bytes;
+    large_allocations += x.large_allocations;
+    large_bytes += x.large_bytes;
+    large_cache_bytes += x.large_cache_bytes;
+    return *this;
+  }
+
+  // Calls f(name, bytes) for every size, like dependent::area_stats.
+  template <typename F>
+  void for_each(F f) const {
+    f("dense_blocks", block_bytes);
+    f("dense_used", used_bytes);
+    f("dense_tail_waste", tail_waste_bytes);
+    f("dense_free_lists", free_list_bytes);
+    f("dense_large", large_bytes);
+    f("dense_large_cache", large_cache_bytes);
+  }
+};
+
+// Where clone_from() copied the blocks and large allocations of an arena.
+// Pointers into them are moved to the same place in the copy, others are
+// left alone.
+class dense_relocations {
+  struct area {
+    std::uintptr_t begin;
+    std::uintptr_t end;
+    std::uintptr_t copy;
+  };
+
+  std::vector<area> areas_;
+
+ public:
+  void add(const void* begin, std::size_t bytes, void* copy) {
+    const auto b = reinterpret_cast<std::uintptr_t>(begin);
+    areas_.push_back({b, b + bytes, reinterpret_cast<std::uintptr_t>(copy)});
+  }
+
+  // Has to be called after the last add().
+  void sort() {
+    std::sort(areas_.begin(), areas_.end(),
+              [](const area& x, const area& y) { return x.begin < y.begin; });
+  }
+
+  template <typename T>
+  T* operator()(T* p) const noexcept {
+    const auto x = reinterpret_cast<std::uintptr_t>(p);
+    auto it = std::upper_bound(
+        areas_.begin(), areas_.end(), x,
+        [](std::uintptr_t y, const area& a) { return y < a.begin; });
+    if (it == areas_.begin() || x >= (--it)->end) return p;
+    return reinterpret_cast<T*>(it->copy + (x - it->begin));
+  }
+};
+
 namespace detail {
 
-// TODO: forward_list nodes are poorly aligned.
-constexpr std::size_t memory_block_size = 4096;
+// Size classes in cages: 1, 2, 3, 4, then two per power of two
+// (6, 8, 12, 16, 24, 32, ...), so rounding adds less than half a request.
+constexpr std::size_t size_class_of(std::size_t n) noexcept {
+  if (n <= 4) return n - 1;
+  std::size_t k = 63 - __builtin_clzll(n - 1);
+  std::size_t half_step = std::size_t{1} << (k - 1);
+  return 4 + 2 * (k - 2) + ((n - 1) >= (std::size_t{1} << k) + half_step);
+}
+
+constexpr std::size_t size_class_size(std::size_t c) noexcept {
+  if (c < 4) return c + 1;
+  std::size_t k = 2 + (c - 4) / 2;
+  return (c - 4) % 2 ? std::size_t{1} << (k + 1)
+                     : (std::size_t{1} << k) + (std::size_t{1} << (k - 1));
+}
+
+// Free lists of freed block allocations, one per size class up to
+// max_cages. The last class is cut down to max_cages, so everything that
+// fits in a block has a class. The list nodes are the freed cages themselves: the first
+// pointer sized bytes hold the next free allocation of the same class.
+template <bool Enabled, std::size_t sizeof_T, std::size_t max_cages>
+class dense_free_lists {
+ public:
+  static constexpr std::size_t round_size(std::size_t size) noexcept {
+    return size;
+  }
+  void* pop(std::size_t) noexcept { return nullptr; }
+  bool push(void*, std::size_t) noexcept { return false; }
+  std::size_t cages() const noexcept { return 0; }
+};
+
+template <std::size_t sizeof_T, std::size_t max_cages>
+class dense_free_lists<true, sizeof_T, max_cages> {
+  // Every free allocation has to fit a pointer.
+  static constexpr std::size_t min_cages =
+      (sizeof(void*) + sizeof_T - 1) / sizeof_T;
+  static constexpr std::size_t class_count =
+      max_cages ? size_class_of(max_cages) + 1 : 0;
+
+  std::array<void*, class_count> heads_{};
+
+  static constexpr bool has_class(std::size_t size) noexcept {
+    return size <= max_cages;
+  }
+
+  static constexpr std::size_t class_size(std::size_t c) noexcept {
+    return std::min(size_class_size(c), max_cages);
+  }
+
+ public:
+  // The size actually taken from a block for a request of size cages.
+  // Sizes that don't fit in a block aren't rounded.
+  static constexpr std::size_t round_size(std::size_t size) noexcept {
+    size = std::max(size, min_cages);
+    if (!has_class(size)) return size;
+    return class_size(size_class_of(size));
+  }
+
+  void* pop(std::size_t size) noexcept {
+    if (!has_class(size)) return nullptr;
+    auto& head = heads_[size_class_of(size)];
+    void* res = head;
+    if (res) std::memcpy(&head, res, sizeof(void*));
+    return res;
+  }
+
+  // size has to be a result of round_size.
+  bool push(void* p, std::size_t size) noexcept {
+    if (!has_class(size)) return false;
+    auto& head = heads_[size_class_of(size)];
+    std::memcpy(p, &head, sizeof(void*));
+    head = p;
+    return true;
+  }
+
+  // Total size of the free allocations, by walking the lists.
+  std::size_t cages() const noexcept {
+    std::size_t res = 0;
+    for (std::size_t c = 0; c != class_count; ++c) {
+      for (void* cur = heads_[c]; cur; std::memcpy(&cur, cur, sizeof(void*)))
+        res += class_size(c);
+    }
+    return res;
+  }
+};
+
+constexpr std::size_t page_size = 4096;
+constexpr std::size_t cache_line_size = 64;
+
+struct alignas(page_size) memory_page {
+  unsigned char bytes[page_size];
+};
+
+// Blocks are whole pages, page aligned, chained in allocation order through
+// a header at the start of their first cache line. Cages start on the next
+// cache line.
+struct memory_block_header {
+  memory_block_header* next;
+  std::size_t pages;
+  // Cages left unused when the allocator moved to the next block.
+  std::size_t tail_waste;
+};
+
+// Allocations too big for a block have pages of their own, with this header
+// in the first cache line. Live ones are linked newest first, so the ones
+// made after a checkpoint are at the front. Cached ones are linked through
+// next.
+struct large_allocation_header {
+  large_allocation_header* prev;
+  large_allocation_header* next;
+  std::size_t pages;
+  std::size_t serial;
+};
+
+static_assert(sizeof(large_allocation_header) <= cache_line_size, "");
+
+template <std::size_t alignof_T>
+constexpr std::size_t block_header_space =
+    (sizeof(memory_block_header) + std::max(alignof_T, cache_line_size) - 1) /
+    std::max(alignof_T, cache_line_size) * std::max(alignof_T, cache_line_size);
 
 template <std::size_t sizeof_T, std::size_t alignof_T,
-          typename BackingAllocator>
+          typename BackingAllocator, typename Policy = default_dense_policy>
 class single_dense_allocator {
   using cage = std::aligned_storage_t<sizeof_T, alignof_T>;
-  static constexpr std::size_t cage_count = memory_block_size / sizeof_T;
+
+  static constexpr std::size_t header_space = block_header_space<alignof_T>;
+
+  static constexpr std::size_t cages_in(std::size_t pages) noexcept {
+    return (pages * page_size - header_space) / sizeof_T;
+  }
+
+  static constexpr std::size_t pages_for(std::size_t cages) noexcept {
+    return (header_space + cages * sizeof_T + page_size - 1) / page_size;
+  }
+
+  // Block sizes in pages, big enough for at least one cage.
+  static constexpr std::size_t first_block_pages =
+      std::max(Policy::block_size / page_size, pages_for(1));
+  static constexpr std::size_t max_block_pages =
+      std::max(Policy::max_block_size / page_size, first_block_pages);
+  static constexpr std::size_t max_block_cages = cages_in(max_block_pages);
+
+  using free_lists =
+      dense_free_lists<Policy::reuse_freed, sizeof_T, max_block_cages>;
 
   using backing_allocator_type = BackingAllocator;
   using alloc_traits = std::allocator_traits<backing_allocator_type>;
-  using memory_block = std::array<cage, cage_count>;
-  using memory_blocks_allocator =
-      typename alloc_traits::template rebind_alloc<memory_block>;
-  using backing_allocator_for_t = typename std::allocator_traits<
-      memory_blocks_allocator>::template rebind_alloc<cage>;
-
-  std::forward_list<memory_block, memory_blocks_allocator> memory_blocks_;
-  std::vector<std::pair<
-      typename std::allocator_traits<backing_allocator_for_t>::pointer,
-      std::size_t>>
-      to_delete_;
-  cage* tail_;
+  using backing_allocator_for_t =
+      typename alloc_traits::template rebind_alloc<cage>;
+  using page_allocator =
+      typename alloc_traits::template rebind_alloc<memory_page>;
+  using page_alloc_traits = std::allocator_traits<page_allocator>;
+
+  backing_allocator_for_t backing_allocator_;
+  // Blocks after current_block_ are retained by rewind() and reused before
+  // new ones are allocated.
+  memory_block_header* first_block_ = nullptr;
+  memory_block_header* current_block_ = nullptr;
+  large_allocation_header* large_allocations_ = nullptr;
+  std::size_t large_serial_ = 0;
+  large_allocation_header* large_cache_ = nullptr;
+  std::size_t large_cache_pages_ = 0;
+  cage* block_begin_ = nullptr;
+  cage* block_end_ = nullptr;
+  cage* tail_ = nullptr;
+  std::size_t next_block_pages_ = first_block_pages;
+  free_lists free_lists_;
 
   void* fit_allocation(std::size_t size) {
     auto* to_return = tail_;
@@ -38,39 +296,309 @@ class single_dense_allocator {
     return to_return;
   }
 
+  // Big allocations live outside of the blocks and never end at tail_.
+  bool is_tail_allocation(cage* p, std::size_t size) const {
+    return p >= block_begin_ && p + size == tail_;
+  }
+
+  void enter_block(memory_block_header* block) noexcept {
+    current_block_ = block;
+    if (!block) {
+      block_begin_ = block_end_ = tail_ = nullptr;
+      return;
+    }
+    auto* bytes = reinterpret_cast<unsigned char*>(block);
+    block_begin_ = tail_ = reinterpret_cast<cage*>(bytes + header_space);
+    block_end_ = block_begin_ + cages_in(block->pages);
+  }
+
+  // Blocks are not initialized: every cage is written before it's read.
+  void new_block(std::size_t min_cages) {
+    auto*& next = current_block_ ? current_block_->next : first_block_;
+    if (current_block_) current_block_->tail_waste = block_end_ - tail_;
+    if (next && cages_in(next->pages) >= min_cages) {
+      enter_block(next);
+      return;
+    }
+
+    const auto pages = std::max(next_block_pages_, pages_for(min_cages));
+    page_allocator a{backing_allocator_};
+    memory_page* block = &*page_alloc_traits::allocate(a, pages);
+    next = ::new (static_cast<void*>(block)) memory_block_header{next, pages, 0};
+    enter_block(next);
+    next_block_pages_ =
+        std::min(next_block_pages_ * Policy::block_growth, max_block_pages);
+  }
+
+  static large_allocation_header* large_header_of(void* p) noexcept {
+    return reinterpret_cast<large_allocation_header*>(
+        static_cast<unsigned char*>(p) - header_space);
+  }
+
+  void free_pages(void* p, std::size_t pages) noexcept {
+    page_allocator a{backing_allocator_};
+    page_alloc_traits::deallocate(a, static_cast<memory_page*>(p), pages);
+  }
+
+  // The smallest cached allocation that fits, if it's less than twice as big
+  // as needed.
+  large_allocation_header* take_cached(std::size_t pages) noexcept {
+    large_allocation_header** best = nullptr;
+    for (auto** cur = &large_cache_; *cur; cur = &(*cur)->next) {
+      const auto cached = (*cur)->pages;
+      if (cached >= pages && cached < 2 * pages &&
+          (!best || cached < (*best)->pages))
+        best = cur;
+    }
+    if (!best) return nullptr;
+    auto* res = *best;
+    *best = res->next;
+    large_cache_pages_ -= res->pages;
+    return res;
+  }
+
+  void* allocate_large(std::size_t size) {
+    auto pages = pages_for(size);
+    void* memory = take_cached(pages);
+    if (memory) {
+      pages = static_cast<large_allocation_header*>(memory)->pages;
+    } else {
+      page_allocator a{backing_allocator_};
+      memory = &*page_alloc_traits::allocate(a, pages);
+    }
+    auto* header = ::new (memory) large_allocation_header{
+        nullptr, large_allocations_, pages, large_serial_++};
+    if (large_allocations_) large_allocations_->prev = header;
+    large_allocations_ = header;
+    return static_cast<unsigned char*>(memory) + header_space;
+  }
+
+  void unlink_large(large_allocation_header* header) noexcept {
+    if (header->prev) {
+      header->prev->next = header->next;
+    } else {
+      large_allocations_ = header->next;
+    }
+    if (header->next) header->next->prev = header->prev;
+  }
+
+  void release_large(large_allocation_header* header) noexcept {
+    if ((large_cache_pages_ + header->pages) * page_size <=
+        Policy::large_cache_size) {
+      header->next = large_cache_;
+      large_cache_ = header;
+      large_cache_pages_ += header->pages;
+      return;
+    }
+    free_pages(header, header->pages);
+  }
+
  public:
   explicit single_dense_allocator(const backing_allocator_type& alloc)
-      : memory_blocks_(alloc) {
-    memory_blocks_.emplace_front();
-    tail_ = memory_blocks_.front().begin();
-  }
+      : backing_allocator_(alloc) {}
 
   single_dense_allocator(const single_dense_allocator&) = delete;
   single_dense_allocator& operator=(const single_dense_allocator&) = delete;
 
   ~single_dense_allocator() {
-    backing_allocator_for_t a{memory_blocks_.get_allocator()};
-    for (auto& p : to_delete_) {
-      std::allocator_traits<backing_allocator_for_t>::deallocate(a, p.first,
-                                                                 p.second);
+    release_blocks(first_block_);
+    for (auto* list : {large_allocations_, large_cache_}) {
+      while (list) {
+        auto* header = list;
+        list = header->next;
+        free_pages(header, header->pages);
+      }
     }
   }
 
+  struct checkpoint_type {
+    memory_block_header* block;
+    cage* tail;
+    std::size_t large_serial;
+  };
+
+  checkpoint_type checkpoint() const noexcept {
+    return {current_block_, tail_, large_serial_};
+  }
+
+  // Forgets everything allocated after the checkpoint, without destroying
+  // it. Blocks are kept for the next allocations, allocations too big for a
+  // block are released. Free lists are emptied.
+  void rewind(const checkpoint_type& cp) {
+    while (large_allocations_ && large_allocations_->serial >= cp.large_serial) {
+      auto* header = large_allocations_;
+      unlink_large(header);
+      release_large(header);
+    }
+    free_lists_ = free_lists{};
+    enter_block(cp.block);
+    tail_ = cp.tail;
+  }
+
+  // Rewinds to the empty state, keeping all blocks.
+  void reset() { rewind({nullptr, nullptr, 0}); }
+
+  // Allocations of more than a block get pages of their own.
+  static constexpr bool is_large(std::size_t size) noexcept {
+    return size > max_block_cages;
+  }
+
+  // Starts over with no blocks and returns the old ones, so their live
+  // allocations can be copied to fresh blocks before release_blocks().
+  // Free lists are emptied, large allocations stay.
+  memory_block_header* detach_blocks() noexcept {
+    auto* res = first_block_;
+    first_block_ = nullptr;
+    enter_block(nullptr);
+    free_lists_ = free_lists{};
+    next_block_pages_ = first_block_pages;
+    return res;
+  }
+
+  // Takes detached blocks back instead of releasing them, when copying out
+  // of them failed half way. They go in front of the blocks in use and
+  // count as full.
+  void reattach_blocks(memory_block_header* blocks) noexcept {
+    if (!blocks) return;
+    auto* last = blocks;
+    for (;; last = last->next) {
+      last->tail_waste = 0;
+      if (!last->next) break;
+    }
+    last->next = first_block_;
+    first_block_ = blocks;
+    if (!current_block_) {
+      enter_block(last);
+      tail_ = block_end_;
+    }
+  }
+
+  // Free lists are emptied again, as deallocations since detach_blocks() may
+  // have put old allocations there.
+  void release_blocks(memory_block_header* blocks) noexcept {
+    free_lists_ = free_lists{};
+    while (blocks) {
+      auto* block = blocks;
+      blocks = block->next;
+      free_pages(block, block->pages);
+    }
+  }
+
+  // Copies the blocks in use and the large allocations of other byte for
+  // byte, and adds where they went to relocations. This allocator has to be
+  // empty. Free lists aren't copied: freed allocations are dead memory in
+  // the copy.
+  void clone_from(const single_dense_allocator& other,
+                  dense_relocations& relocations) {
+    assert(!first_block_ && !large_allocations_);
+    page_allocator a{backing_allocator_};
+
+    auto** next = &first_block_;
+    bool before_current = other.current_block_ != nullptr;
+    for (auto* block = other.first_block_; before_current;
+         block = block->next) {
+      before_current = block != other.current_block_;
+      const std::size_t used = before_current
+                                   ? cages_in(block->pages) - block->tail_waste
+                                   : other.tail_ - other.block_begin_;
+      memory_page* pages = &*page_alloc_traits::allocate(a, block->pages);
+      *next = ::new (static_cast<void*>(pages)) memory_block_header{
+          nullptr, block->pages, before_current ? block->tail_waste : 0};
+      std::memcpy(reinterpret_cast<unsigned char*>(pages) + header_space,
+                  reinterpret_cast<const unsigned char*>(block) + header_space,
+                  used * sizeof_T);
+      relocations.add(block, block->pages * page_size, pages);
+      enter_block(*next);
+      tail_ = block_begin_ + used;
+      next = &(*next)->next;
+    }
+    next_block_pages_ = other.next_block_pages_;
+
+    // Newest first, like the originals.
+    large_allocation_header* last = nullptr;
+    for (auto* large = other.large_allocations_; large; large = large->next) {
+      memory_page* pages = &*page_alloc_traits::allocate(a, large->pages);
+      std::memcpy(static_cast<void*>(pages), large, large->pages * page_size);
+      auto* header = ::new (static_cast<void*>(pages)) large_allocation_header{
+          last, nullptr, large->pages, large->serial};
+      (last ? last->next : large_allocations_) = header;
+      last = header;
+      relocations.add(large, large->pages * page_size, pages);
+    }
+    large_serial_ = other.large_serial_;
+  }
+
+  // Walks the blocks, the free lists and the large allocations.
+  dense_allocator_stats stats() const noexcept {
+    dense_allocator_stats res;
+    bool before_current = current_block_ != nullptr;
+    for (auto* block = first_block_; block; block = block->next) {
+      ++res.blocks;
+      res.block_bytes += block->pages * page_size;
+      if (block == current_block_) {
+        res.used_bytes += (tail_ - block_begin_) * sizeof_T;
+        before_current = false;
+      } else if (before_current) {
+        res.used_bytes += (cages_in(block->pages) - block->tail_waste) * sizeof_T;
+        res.tail_waste_bytes += block->tail_waste * sizeof_T;
+      }
+    }
+    res.free_list_bytes = free_lists_.cages() * sizeof_T;
+    res.used_bytes -= res.free_list_bytes;
+    for (auto* large = large_allocations_; large; large = large->next) {
+      ++res.large_allocations;
+      res.large_bytes += large->pages * page_size;
+    }
+    res.large_cache_bytes = large_cache_pages_ * page_size;
+    return res;
+  }
+
   void* allocate(std::size_t size) {
+    size = free_lists::round_size(size);
+    if (void* p = free_lists_.pop(size)) return p;
     // TODO: thinking.
-    if (memory_blocks_.front().end() - tail_ >=
-        static_cast<std::ptrdiff_t>(size)) {
+    if (block_end_ - tail_ >= static_cast<std::ptrdiff_t>(size)) {
       return fit_allocation(size);
     }
-    if (size <= cage_count) {
-      memory_blocks_.emplace_front();
-      tail_ = memory_blocks_.front().begin();
-      return fit_allocation(size);
+    if (is_large(size)) return allocate_large(size);
+    new_block(size);
+    return fit_allocation(size);
+  }
+
+  // Grows or shrinks the most recent allocation if it still fits in its
+  // block, or a large allocation if it still fits in its pages. Sizes are in
+  // cages.
+  bool try_expand(void* p, std::size_t old_size, std::size_t new_size) {
+    if (is_large(old_size)) {
+      return is_large(new_size) &&
+             new_size <= cages_in(large_header_of(p)->pages);
     }
-    backing_allocator_for_t a{memory_blocks_.get_allocator()};
-    auto p = std::allocator_traits<backing_allocator_for_t>::allocate(a, size);
-    to_delete_.emplace_back(p, size);
-    return p;
+    old_size = free_lists::round_size(old_size);
+    new_size = free_lists::round_size(new_size);
+    auto* ptr = static_cast<cage*>(p);
+    if (!is_tail_allocation(ptr, old_size)) return false;
+    if (block_end_ - ptr < static_cast<std::ptrdiff_t>(new_size)) return false;
+    tail_ = ptr + new_size;
+    return true;
+  }
+
+  // The most recent allocation is given back to the block. Others are reused
+  // if the Policy asks for it, or stay until the allocator is destroyed.
+  // Large allocations are released right away.
+  void deallocate(void* p, std::size_t size) {
+    if (is_large(size)) {
+      auto* header = large_header_of(p);
+      unlink_large(header);
+      release_large(header);
+      return;
+    }
+    size = free_lists::round_size(size);
+    auto* ptr = static_cast<cage*>(p);
+    if (is_tail_allocation(ptr, size)) {
+      tail_ = ptr;
+      return;
+    }
+    free_lists_.push(p, size);
   }
 };
 
@@ -79,9 +607,10 @@ class single_dense_allocator {
 template <std::size_t size, std::size_t alignment>
 using unknown_type = std::aligned_storage_t<size, alignment>;
 
-template <typename Alloc, typename... Ts>
-struct dense_allocators
-    : detail::single_dense_allocator<sizeof(Ts), alignof(Ts), Alloc>... {
+template <typename Policy, typename Alloc, typename... Ts>
+struct basic_dense_allocators
+    : detail::single_dense_allocator<sizeof(Ts), alignof(Ts), Alloc, Policy>... {
+  using policy_type = Policy;
   using backing_allocator_type = Alloc;
   using alloc_traits = std::allocator_traits<backing_allocator_type>;
   using pointer = typename alloc_traits::pointer;
@@ -90,15 +619,109 @@ struct dense_allocators
 
   // This is an only way I could find to make a reasonable error message with sizes.
   template <std::size_t size, std::size_t alignment>
-  detail::single_dense_allocator<size, alignment, backing_allocator_type>& as_allocator_for_T() {
+  detail::single_dense_allocator<size, alignment, backing_allocator_type, Policy>& as_allocator_for_T() {
     return *this;
   }
 
-  dense_allocators(const backing_allocator_type& a)
-      : detail::single_dense_allocator<sizeof(Ts), alignof(Ts), backing_allocator_type>(a)...,
+  basic_dense_allocators(const backing_allocator_type& a)
+      : detail::single_dense_allocator<sizeof(Ts), alignof(Ts), backing_allocator_type, Policy>(a)...,
         backing_allocator_(a) {}
+
+  template <typename T>
+  using single_allocator_for =
+      detail::single_dense_allocator<sizeof(T), alignof(T), backing_allocator_type, Policy>;
+
+  // Position of every single allocator, see rewind().
+  using checkpoint_type =
+      std::tuple<typename single_allocator_for<Ts>::checkpoint_type...>;
+
+  checkpoint_type checkpoint() const noexcept {
+    return checkpoint_type{
+        static_cast<const single_allocator_for<Ts>&>(*this).checkpoint()...};
+  }
+
+  // Everything allocated after the checkpoint is gone and has to be
+  // abandoned without being destroyed or deallocated. The blocks are kept, so
+  // after warm up a rewind/allocate cycle doesn't touch the backing
+  // allocator.
+  void rewind(const checkpoint_type& cp) {
+    rewind_impl(cp, std::index_sequence_for<Ts...>{});
+  }
+
+  void reset() { (static_cast<single_allocator_for<Ts>&>(*this).reset(), ...); }
+
+  using detached_blocks_type =
+      std::array<detail::memory_block_header*, sizeof...(Ts)>;
+
+  // Detaches the blocks of every single allocator, see
+  // single_dense_allocator::detach_blocks().
+  detached_blocks_type detach_blocks() noexcept {
+    return {static_cast<single_allocator_for<Ts>&>(*this).detach_blocks()...};
+  }
+
+  void release_blocks(const detached_blocks_type& blocks) noexcept {
+    release_blocks_impl(blocks, std::index_sequence_for<Ts...>{});
+  }
+
+  void reattach_blocks(const detached_blocks_type& blocks) noexcept {
+    reattach_blocks_impl(blocks, std::index_sequence_for<Ts...>{});
+  }
+
+  // Copies the blocks and large allocations of every single allocator of
+  // other, see single_dense_allocator::clone_from(). This arena has to be
+  // empty. Returns where everything went.
+  dense_relocations clone_from(const basic_dense_allocators& other) {
+    dense_relocations res;
+    (static_cast<single_allocator_for<Ts>&>(*this).clone_from(
+         static_cast<const single_allocator_for<Ts>&>(other), res),
+     ...);
+    res.sort();
+    return res;
+  }
+
+  // Stats of every single allocator, in the order of Ts.
+  std::array<dense_allocator_stats, sizeof...(Ts)> stats() const noexcept {
+    return {static_cast<const single_allocator_for<Ts>&>(*this).stats()...};
+  }
+
+  dense_allocator_stats total_stats() const noexcept {
+    dense_allocator_stats res;
+    for (const auto& s : stats()) res += s;
+    return res;
+  }
+
+ private:
+  template <std::size_t... I>
+  void rewind_impl(const checkpoint_type& cp, std::index_sequence<I...>) {
+    (static_cast<single_allocator_for<Ts>&>(*this).rewind(std::get<I>(cp)),
+     ...);
+  }
+
+  template <std::size_t... I>
+  void release_blocks_impl(const detached_blocks_type& blocks,
+                           std::index_sequence<I...>) noexcept {
+    (static_cast<single_allocator_for<Ts>&>(*this).release_blocks(blocks[I]),
+     ...);
+  }
+
+  template <std::size_t... I>
+  void reattach_blocks_impl(const detached_blocks_type& blocks,
+                            std::index_sequence<I...>) noexcept {
+    (static_cast<single_allocator_for<Ts>&>(*this).reattach_blocks(blocks[I]),
+     ...);
+  }
 };
 
+template <typename Alloc, typename... Ts>
+using dense_allocators =
+    basic_dense_allocators<default_dense_policy, Alloc, Ts...>;
+
+// Dense allocators that reuse freed memory, for containers with erase/insert
+// churn.
+template <typename Alloc, typename... Ts>
+using reusing_dense_allocators =
+    basic_dense_allocators<reusing_dense_policy, Alloc, Ts...>;
+
 template <typename T, typename DenseAllocator>
 class dense_allocator_handler {
   using backing_allocator_type =
@@ -140,7 +763,16 @@ class dense_allocator_handler {
     return static_cast<T*>(as_t_alloc.allocate(size));
   }
 
-  void deallocate(T*, std::size_t) {}
+  void deallocate(T* p, std::size_t size) {
+    auto& as_t_alloc = dense_allocator_->template as_allocator_for_T<sizeof(T), alignof(T)>();
+    as_t_alloc.deallocate(p, size);
+  }
+
+  // Resizes an allocation without moving it, see detail::try_expand.
+  bool try_expand(T* p, std::size_t old_size, std::size_t new_size) {
+    auto& as_t_alloc = dense_allocator_->template as_allocator_for_T<sizeof(T), alignof(T)>();
+    return as_t_alloc.try_expand(p, old_size, new_size);
+  }
 
   friend bool operator==(const dense_allocator_handler& x,
                          const dense_allocator_handler& y) {
@@ -154,3 +786,5 @@ class dense_allocator_handler {
 };
 
 }  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_DENSE_ALLOCATOR_H_
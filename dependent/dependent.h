@@ -4,13 +4,17 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <scoped_allocator>
 #include <tuple>
 #include <type_traits>
 
+#include "dependent/compare.h"
 #include "dependent/future_std_stubs.h"
+#include "dependent/hash.h"
 
 namespace dependent_lib {
 
@@ -73,6 +77,15 @@ auto forward_end(std::remove_reference_t<R>&& r) {
   return std::make_move_iterator(std::end(r));
 }
 
+template <typename R, typename = void>
+struct ContiguousRangeImpl : std::false_type {};
+
+template <typename R>
+struct ContiguousRangeImpl<
+    R, void_t<decltype(std::data(std::declval<const R&>()),
+                       std::size(std::declval<const R&>()))>>
+    : std::true_type {};
+
 }  // namespace detail
 
 template <typename T, typename A>
@@ -105,7 +118,8 @@ using size_type_t = std::tuple_element_t<select_size_type<T>(), size_types>;
 
 template <typename T>
 constexpr std::ptrdiff_t required_space_in_types(std::ptrdiff_t size) {
-  if (size < std::numeric_limits<size_type_t<T>>::max()) {
+  if (static_cast<bigest_size_type>(size) <
+      std::numeric_limits<size_type_t<T>>::max()) {
     return size + 1;
   }
   constexpr std::size_t size_t_offset =
@@ -117,7 +131,29 @@ template <typename I, typename Alloc>
 void destroy(I f, I l, Alloc a) {
   using ri = std::reverse_iterator<I>;
   for (ri it{l}; it != ri{f}; ++it)
-    std::allocator_traits<Alloc>::destroy(a, it.base());
+    std::allocator_traits<Alloc>::destroy(a, std::addressof(*it));
+}
+
+template <typename A, typename T, typename = void>
+struct HasTryExpandImpl : std::false_type {};
+
+template <typename A, typename T>
+struct HasTryExpandImpl<
+    A, T,
+    void_t<decltype(std::declval<A&>().try_expand(
+        std::declval<T*>(), std::size_t{}, std::size_t{}))>>
+    : std::true_type {};
+
+// Resizes the allocation at p from old_size to new_size elements without
+// moving it, if the allocator knows how (e.g. dense_allocator_handler for
+// its most recent allocation). Returns false otherwise.
+template <typename A, typename T>
+bool try_expand(A& a, T* p, std::size_t old_size, std::size_t new_size) {
+  if constexpr (HasTryExpandImpl<A, T>::value) {
+    return a.try_expand(p, old_size, new_size);
+  } else {
+    return false;
+  }
 }
 
 template <typename A>
@@ -181,49 +217,325 @@ auto unaligned_read(T* ptr) -> std::pair<T*, forward_const_t<T, U>&> {
   return {static_cast<std::remove_const_t<T>*>(raw_ptr), *as_u};
 }
 
-template <typename T, typename Span, typename Alloc>
-struct leaky_vector {
-  using allocator_type = Alloc;
-  using alloc_traits = std::allocator_traits<Alloc>;
-  using pointer = typename alloc_traits::pointer;
-  using size_type = std::size_t;
-  using span_type = Span;
+// Trivially copyable elements that don't take an allocator are constructed
+// with a single memcpy from pointers into contiguous storage.
+template <typename T, typename Alloc>
+constexpr bool bulk_copyable = std::is_trivially_copyable<T>::value &&
+                               !std::uses_allocator<T, Alloc>::value;
 
-  static constexpr std::size_t big_size_marker =
-      std::numeric_limits<size_type_t<T>>::max();
+template <typename T, typename Alloc, typename I>
+struct BulkCopyIteratorImpl
+    : std::integral_constant<
+          bool, bulk_copyable<T, Alloc> && std::is_pointer<I>::value &&
+                    std::is_same<std::remove_cv_t<std::remove_pointer_t<I>>,
+                                 T>::value> {};
 
-  pointer data_;
+template <typename T, typename Alloc, typename I>
+struct BulkCopyIteratorImpl<T, Alloc, std::move_iterator<I>>
+    : BulkCopyIteratorImpl<T, Alloc, I> {};
+
+template <typename I>
+I iterator_base(I it) {
+  return it;
+}
 
-  detail::size_type_t<T>& small_size() {
-    return *reinterpret_cast<detail::size_type_t<T>*>(data_);
+template <typename I>
+I iterator_base(std::move_iterator<I> it) {
+  return it.base();
+}
+
+template <typename T, typename Alloc, typename R>
+constexpr bool bulk_copyable_range() {
+  if constexpr (ContiguousRangeImpl<std::remove_reference_t<R>>::value) {
+    return BulkCopyIteratorImpl<
+        T, Alloc, decltype(std::data(std::declval<R&>()))>::value;
+  } else {
+    return false;
   }
+}
 
-  const detail::size_type_t<T>& small_size() const {
-    return *reinterpret_cast<const detail::size_type_t<T>*>(data_);
+template <typename T, typename Alloc, typename R>
+auto range_begin(std::remove_reference_t<R>& r) {
+  if constexpr (bulk_copyable_range<T, Alloc, R>()) {
+    return std::data(r);
+  } else {
+    return forward_begin<R>(r);
   }
+}
 
-  T* unaligned_write_size(size_type dist) {
-    if (dist < big_size_marker) {
-      small_size() = dist;
-      return &*data_ + 1;
+template <typename T, typename Alloc, typename R>
+auto range_end(std::remove_reference_t<R>& r) {
+  if constexpr (bulk_copyable_range<T, Alloc, R>()) {
+    return std::data(r) + std::size(r);
+  } else {
+    return forward_end<R>(r);
+  }
+}
+
+template <typename T, typename = void>
+struct HasCachedHashImpl : std::false_type {};
+
+template <typename T>
+struct HasCachedHashImpl<
+    T, void_t<decltype(std::declval<const T&>().cached_hash())>>
+    : std::true_type {};
+
+// Vectors with a hashed_header wide enough to be the span hash itself.
+template <typename T, typename = void>
+struct HasFullCachedHashImpl : std::false_type {};
+
+template <typename T>
+struct HasFullCachedHashImpl<T, std::enable_if_t<HasCachedHashImpl<T>::value>>
+    : std::is_same<decltype(std::declval<const T&>().cached_hash()),
+                   std::size_t> {};
+
+}  // namespace detail
+
+// Header policies describe what is written in front of a dependent vector's
+// payload. The header is part of the same allocation as the payload, so the
+// vector itself stays a single pointer.
+//
+// A policy provides (all static, T is the element type):
+//   required_space_in_types<T>(size) - allocation size in Ts,
+//   write_header<T>(data, size)      - writes the header, returns the payload,
+//   begin_end<T>(data)               - payload bounds of an existing vector,
+//   seal<T>(data, f, l)              - called once the payload is constructed.
+//   stores_size                      - false if the owner keeps the size, then
+//                                      begin_end<T>(data, size) is used.
+
+// Size in a single size_type_t<T>, big sizes in an extra aligned size_t.
+struct size_prefix_header {
+  static constexpr bool stores_size = true;
+
+  template <typename T>
+  static constexpr std::size_t big_size_marker =
+      std::numeric_limits<detail::size_type_t<T>>::max();
+
+  template <typename T>
+  static constexpr std::ptrdiff_t required_space_in_types(
+      std::ptrdiff_t size) {
+    return detail::required_space_in_types<T>(size);
+  }
+
+  template <typename T>
+  static T* write_header(T* data, std::size_t size) noexcept {
+    auto& small_size = *reinterpret_cast<detail::size_type_t<T>*>(data);
+    if (size < big_size_marker<T>) {
+      small_size = size;
+      return data + 1;
     }
 
-    small_size() = big_size_marker;
-    auto p = unaligned_read<std::size_t>(&*data_ + 1);
-    p.second = static_cast<std::size_t>(dist);
+    small_size = big_size_marker<T>;
+    auto p = detail::unaligned_read<std::size_t>(data + 1);
+    p.second = size;
     return p.first;
   }
 
-  std::pair<const T*, const T*> begin_end() const noexcept {
-    const T* begin = &*data_ + 1;
-    if (small_size() < big_size_marker) {
-      return {begin, begin + small_size()};
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data) noexcept {
+    const auto small_size =
+        *reinterpret_cast<const detail::size_type_t<T>*>(data);
+    const T* begin = data + 1;
+    if (small_size < big_size_marker<T>) {
+      return {begin, begin + small_size};
     }
     std::size_t big_size;
-    std::tie(begin, big_size) = unaligned_read<std::size_t>(begin);
+    std::tie(begin, big_size) = detail::unaligned_read<std::size_t>(begin);
     return {begin, begin + big_size};
   }
 
+  template <typename T>
+  static void seal(T*, const T*, const T*) noexcept {}
+};
+
+// Size as LEB128: 7 bits per byte, the high bit marks that more bytes follow.
+// Uses the least memory (2 bytes for sizes below 16384) at the cost of a short
+// decoding loop. The bytes are padded to a whole number of Ts.
+struct varint_size_header {
+  static constexpr bool stores_size = true;
+
+  static constexpr std::size_t varint_bytes(std::size_t size) noexcept {
+    std::size_t res = 1;
+    for (; size >= 0x80; size >>= 7) ++res;
+    return res;
+  }
+
+  template <typename T>
+  static constexpr std::ptrdiff_t header_space(std::size_t size) noexcept {
+    return (varint_bytes(size) + sizeof(T) - 1) / sizeof(T);
+  }
+
+  template <typename T>
+  static constexpr std::ptrdiff_t required_space_in_types(
+      std::ptrdiff_t size) {
+    return header_space<T>(size) + size;
+  }
+
+  template <typename T>
+  static T* write_header(T* data, std::size_t size) noexcept {
+    auto* out = reinterpret_cast<unsigned char*>(data);
+    const auto space = header_space<T>(size);
+    for (; size >= 0x80; size >>= 7)
+      *out++ = static_cast<unsigned char>(size | 0x80);
+    *out = static_cast<unsigned char>(size);
+    return data + space;
+  }
+
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data) noexcept {
+    auto* in = reinterpret_cast<const unsigned char*>(data);
+    std::size_t size = 0;
+    std::size_t bytes = 0;
+    unsigned char byte;
+    do {
+      byte = in[bytes];
+      size |= static_cast<std::size_t>(byte & 0x7f) << (7 * bytes);
+      ++bytes;
+    } while (byte & 0x80);
+    const T* begin = data + (bytes + sizeof(T) - 1) / sizeof(T);
+    return {begin, begin + size};
+  }
+
+  template <typename T>
+  static void seal(T*, const T*, const T*) noexcept {}
+};
+
+// Size in a uint32_t, decoded without branches. Sizes have to fit in 32 bits.
+struct fixed_size_header {
+  static constexpr bool stores_size = true;
+
+  template <typename T>
+  static constexpr std::ptrdiff_t header_space =
+      (sizeof(uint32_t) + sizeof(T) - 1) / sizeof(T);
+
+  template <typename T>
+  static constexpr std::ptrdiff_t required_space_in_types(
+      std::ptrdiff_t size) {
+    return header_space<T> + size;
+  }
+
+  template <typename T>
+  static T* write_header(T* data, std::size_t size) noexcept {
+    assert(size <= std::numeric_limits<uint32_t>::max());
+    auto size32 = static_cast<uint32_t>(size);
+    std::memcpy(data, &size32, sizeof(size32));
+    return data + header_space<T>;
+  }
+
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data) noexcept {
+    uint32_t size;
+    std::memcpy(&size, data, sizeof(size));
+    const T* begin = data + header_space<T>;
+    return {begin, begin + size};
+  }
+
+  template <typename T>
+  static void seal(T*, const T*, const T*) noexcept {}
+};
+
+// No header at all, for data sized by its owner (e.g. all keys of a known
+// length, or a size kept in a parallel array). Such vectors are read with
+// as_span(size) and released with destroy(allocator, size).
+struct no_size_header {
+  static constexpr bool stores_size = false;
+
+  template <typename T>
+  static constexpr std::ptrdiff_t required_space_in_types(
+      std::ptrdiff_t size) {
+    return size;
+  }
+
+  template <typename T>
+  static T* write_header(T* data, std::size_t) noexcept {
+    return data;
+  }
+
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data,
+                                                 std::size_t size) noexcept {
+    return {data, data + size};
+  }
+
+  template <typename T>
+  static void seal(T*, const T*, const T*) noexcept {}
+};
+
+// Stores the hash of the payload in front of the Inner header, so rehashing
+// and equality checks of mismatching vectors don't read the payload.
+// The hash is the one span_hash computes for the same elements (truncated to
+// HashValue).
+template <typename HashValue = std::size_t,
+          typename Inner = size_prefix_header>
+struct hashed_header {
+  using hash_type = HashValue;
+
+  static constexpr bool stores_size = Inner::stores_size;
+
+  template <typename T>
+  static constexpr std::ptrdiff_t hash_space =
+      (sizeof(hash_type) + sizeof(T) - 1) / sizeof(T);
+
+  template <typename T>
+  static constexpr std::ptrdiff_t required_space_in_types(
+      std::ptrdiff_t size) {
+    return hash_space<T> + Inner::template required_space_in_types<T>(size);
+  }
+
+  template <typename T>
+  static T* write_header(T* data, std::size_t size) noexcept {
+    return Inner::write_header(data + hash_space<T>, size);
+  }
+
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data) noexcept {
+    return Inner::begin_end(data + hash_space<T>);
+  }
+
+  // For Inner headers that don't store the size.
+  template <typename T>
+  static std::pair<const T*, const T*> begin_end(const T* data,
+                                                 std::size_t size) noexcept {
+    return Inner::begin_end(data + hash_space<T>, size);
+  }
+
+  template <typename T>
+  static void seal(T* data, const T* f, const T* l) noexcept {
+    Inner::seal(data + hash_space<T>, f, l);
+    auto h = static_cast<hash_type>(detail::hash_span(f, l));
+    std::memcpy(static_cast<void*>(data), &h, sizeof(h));
+  }
+
+  template <typename T>
+  static hash_type cached_hash(const T* data) noexcept {
+    hash_type h;
+    std::memcpy(&h, data, sizeof(h));
+    return h;
+  }
+};
+
+namespace detail {
+
+template <typename T, typename Span, typename Alloc,
+          typename Header = size_prefix_header>
+struct leaky_vector {
+  using allocator_type = Alloc;
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using pointer = typename alloc_traits::pointer;
+  using size_type = std::size_t;
+  using span_type = Span;
+  using header_type = Header;
+
+  pointer data_;
+
+  T* unaligned_write_size(size_type dist) {
+    return Header::write_header(&*data_, dist);
+  }
+
+  std::pair<const T*, const T*> begin_end() const noexcept {
+    return Header::begin_end(static_cast<const T*>(&*data_));
+  }
+
   std::pair<T*, T*> begin_end() noexcept {
     auto p = static_cast<const leaky_vector*>(this)->begin_end();
     return {const_cast<T*>(p.first), const_cast<T*>(p.second)};
@@ -234,8 +546,23 @@ struct leaky_vector {
     return p.second - p.first;
   }
 
+  // For headers that don't store the size.
+  std::pair<const T*, const T*> begin_end(size_type n) const noexcept {
+    return Header::begin_end(static_cast<const T*>(&*data_), n);
+  }
+
+  std::pair<T*, T*> begin_end(size_type n) noexcept {
+    auto p = static_cast<const leaky_vector*>(this)->begin_end(n);
+    return {const_cast<T*>(p.first), const_cast<T*>(p.second)};
+  }
+
+  template <typename H = Header>
+  auto cached_hash() const noexcept -> typename H::hash_type {
+    return H::cached_hash(static_cast<const T*>(&*data_));
+  }
+
   constexpr static std::size_t required_allocation_size(std::ptrdiff_t dist) {
-    auto space_in_types = detail::required_space_in_types<T>(dist);
+    auto space_in_types = Header::template required_space_in_types<T>(dist);
     return space_in_types;
   }
 
@@ -246,19 +573,27 @@ struct leaky_vector {
     data_ = alloc_traits::allocate(a, allocated_memory);
 
     T* t_begin = unaligned_write_size(dist);
+    if constexpr (BulkCopyIteratorImpl<T, Alloc, I>::value) {
+      if (dist) std::memcpy(t_begin, iterator_base(f), dist * sizeof(T));
+      Header::seal(&*data_, t_begin, t_begin + dist);
+      return;
+    }
+
     T* t_cur = t_begin;
     try {
       for (; f != l; ++f, ++t_cur) alloc_traits::construct(a, t_cur, *f);
     } catch (...) {
       detail::destroy(t_begin, t_cur, a);
       alloc_traits::deallocate(a, data_, allocated_memory);
+      throw;
     }
+    Header::seal(&*data_, t_begin, t_cur);
   }
 
   template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
   leaky_vector(std::allocator_arg_t, allocator_type a, R&& r)
-      : leaky_vector(std::allocator_arg, a, forward_begin<R>(r),
-                     forward_end<R>(r)) {}
+      : leaky_vector(std::allocator_arg, a, range_begin<T, Alloc, R>(r),
+                     range_end<T, Alloc, R>(r)) {}
 
   leaky_vector(std::allocator_arg_t, allocator_type, leaky_vector&& rhs)
       : leaky_vector(std::move(rhs)) {}
@@ -268,10 +603,18 @@ struct leaky_vector {
     return {p.first, p.second};
   }
 
+  span_type as_span(size_type n) const noexcept {
+    auto p = begin_end(n);
+    return {p.first, p.second};
+  }
+
   friend bool operator==(const leaky_vector& x, const leaky_vector& y) {
+    if constexpr (HasCachedHashImpl<leaky_vector>::value) {
+      if (x.cached_hash() != y.cached_hash()) return false;
+    }
     auto xs = x.as_span();
     auto ys = y.as_span();
-    return std::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+    return detail::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
   }
 
   friend bool operator!=(const leaky_vector& x, const leaky_vector& y) {
@@ -281,8 +624,8 @@ struct leaky_vector {
   friend bool operator<(const leaky_vector& x, const leaky_vector& y) {
     auto xs = x.as_span();
     auto ys = y.as_span();
-    return std::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
-                                        ys.end());
+    return detail::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
+                                           ys.end());
   }
 
   friend bool operator>(const leaky_vector& x, const leaky_vector& y) {
@@ -304,24 +647,25 @@ template <typename A>
 using allocator_adaptor =
     std::scoped_allocator_adaptor<detail::allocator_adaptor_impl<A>>;
 
-template <typename T, typename Alloc>
+template <typename T, typename Alloc, typename Header = size_prefix_header>
 class vector;
 
-template <typename T, typename Alloc>
-class leaky_vector : detail::leaky_vector<T, span<const T>, Alloc> {
-  friend class vector<T, Alloc>;
-  using base = detail::leaky_vector<T, span<const T>, Alloc>;
+template <typename T, typename Alloc, typename Header = size_prefix_header>
+class leaky_vector : detail::leaky_vector<T, span<const T>, Alloc, Header> {
+  friend class vector<T, Alloc, Header>;
+  using base = detail::leaky_vector<T, span<const T>, Alloc, Header>;
   base& as_base() noexcept { return *this; };
   const base& as_base() const noexcept { return *this; };
 
  public:
   using base::as_span;
+  using base::cached_hash;
 
   template <typename... Args>
   leaky_vector(Args&&... args) : base(std::forward<Args>(args)...) {}
 
   friend bool operator==(const leaky_vector& x, const leaky_vector& y) {
-    return x.as_base() < y.as_base();
+    return x.as_base() == y.as_base();
   }
 
   friend bool operator!=(const leaky_vector& x, const leaky_vector& y) {
@@ -345,20 +689,74 @@ class leaky_vector : detail::leaky_vector<T, span<const T>, Alloc> {
   }
 };
 
-template <typename T, typename Alloc>
-class vector : public leaky_vector<T, Alloc> {
-  using base = leaky_vector<T, Alloc>;
+template <typename T, typename Alloc, typename Header>
+class vector : public leaky_vector<T, Alloc, Header> {
+  using base = leaky_vector<T, Alloc, Header>;
   using alloc_traits = std::allocator_traits<Alloc>;
 
  public:
   using allocator_type = typename base::allocator_type;
+  using value_type = T;
 
   template <typename... Args>
   vector(Args&&... args) : base(std::forward<Args>(args)...) {}
 
+  // Not available without a stored size, so containers using
+  // allocator_adaptor don't treat such vectors as DependentType.
+  template <typename H = Header,
+            typename = std::enable_if_t<H::stores_size>>
   void destroy(allocator_type a) {
     T *f, *l;
     std::tie(f, l) = this->begin_end();
+    release(a, f, l);
+  }
+
+  void destroy(allocator_type a, std::size_t size) {
+    T *f, *l;
+    std::tie(f, l) = this->begin_end(size);
+    release(a, f, l);
+  }
+
+  // Size of the payload in Ts, as passed to the allocator.
+  template <typename H = Header,
+            typename = std::enable_if_t<H::stores_size>>
+  std::size_t allocation_size() const noexcept {
+    return this->required_allocation_size(this->size());
+  }
+
+  // Copies the payload to a new allocation from a and points to it. The old
+  // allocation is neither destroyed nor deallocated, see compact().
+  template <typename H = Header,
+            typename = std::enable_if_t<H::stores_size>>
+  void relocate(allocator_type a) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "elements are moved with memcpy");
+    const auto n = allocation_size();
+    auto p = alloc_traits::allocate(a, n);
+    std::memcpy(static_cast<void*>(&*p), static_cast<const void*>(&*this->data_),
+                n * sizeof(T));
+    this->data_ = p;
+  }
+
+  // Points to f(data) instead: a copy of the payload made behind the
+  // allocator's back, see clone().
+  template <typename F>
+  void rebase(F f) {
+    this->data_ = f(this->data_);
+  }
+
+  // Calls f(T&) on every element. f may change an element only in ways that
+  // keep it equal, like relocating a dependent element.
+  template <typename F, typename H = Header,
+            typename = std::enable_if_t<H::stores_size>>
+  void update_elements(F f) {
+    T *first, *last;
+    std::tie(first, last) = this->begin_end();
+    for (; first != last; ++first) f(*first);
+  }
+
+ private:
+  void release(allocator_type a, T* f, T* l) {
     detail::destroy(f, l, a);
     alloc_traits::deallocate(a, this->data_,
                              this->required_allocation_size(l - f));
@@ -366,6 +764,41 @@ class vector : public leaky_vector<T, Alloc> {
   }
 };
 
+namespace detail {
+
+// Hash of the elements, equal to std::hash of a span over the same elements.
+template <typename V>
+std::size_t hash_vector(const V& x) noexcept {
+  if constexpr (HasFullCachedHashImpl<V>::value) {
+    return x.cached_hash();
+  } else {
+    auto sp = x.as_span();
+    return hash_span(sp.begin(), sp.end());
+  }
+}
+
+}  // namespace detail
+
 }  // namespace dependent_lib
 
+namespace std {
+
+template <typename T, typename Alloc, typename Header>
+struct hash<dependent_lib::leaky_vector<T, Alloc, Header>> {
+  std::size_t operator()(
+      const dependent_lib::leaky_vector<T, Alloc, Header>& x) const noexcept {
+    return dependent_lib::detail::hash_vector(x);
+  }
+};
+
+template <typename T, typename Alloc, typename Header>
+struct hash<dependent_lib::vector<T, Alloc, Header>> {
+  std::size_t operator()(
+      const dependent_lib::vector<T, Alloc, Header>& x) const noexcept {
+    return dependent_lib::detail::hash_vector(x);
+  }
+};
+
+}  // namespace std
+
 #endif  // _DEPENDENT_LIB_H_
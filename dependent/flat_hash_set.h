@@ -0,0 +1,553 @@
+#ifndef _DEPENDENT_LIB_FLAT_HASH_SET_H_
+#define _DEPENDENT_LIB_FLAT_HASH_SET_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Open addressing hash set in the spirit of swiss tables.
+//
+// Elements are stored inline in a slot array, a parallel array of control
+// bytes keeps 7 bits of every element's hash. A lookup scans a whole group of
+// control bytes at once and touches a slot only when those 7 bits match, so
+// for dependent vectors a successful lookup costs the control group, the
+// 8 byte handle and the payload.
+//
+// Elements are constructed and destroyed through the allocator, so with
+// allocator_adaptor dependent elements receive the allocator and have their
+// payload destroyed when they are erased. Moving elements between slots
+// (rehashing) never goes through the allocator.
+
+namespace dependent_lib {
+
+namespace detail {
+
+using ctrl_t = int8_t;
+
+// Full slots hold the 7 low bits of the hash: [0, 127].
+constexpr ctrl_t ctrl_empty = -128;
+constexpr ctrl_t ctrl_deleted = -2;
+
+constexpr std::size_t group_width = 16;
+
+// Bit i is set if the i-th control byte of a group matches.
+class group_mask {
+  uint32_t mask_;
+
+ public:
+  explicit group_mask(uint32_t mask) : mask_(mask) {}
+
+  explicit operator bool() const { return mask_ != 0; }
+
+  std::size_t lowest() const { return __builtin_ctz(mask_); }
+
+  void clear_lowest() { mask_ &= mask_ - 1; }
+};
+
+#ifdef __SSE2__
+
+class group {
+  __m128i ctrl_;
+
+ public:
+  explicit group(const ctrl_t* p)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+  group_mask match(ctrl_t h2) const {
+    return group_mask(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_))));
+  }
+
+  group_mask match_empty() const { return match(ctrl_empty); }
+
+  // Both special values are negative, full slots are not.
+  group_mask match_empty_or_deleted() const {
+    return group_mask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl_)));
+  }
+};
+
+#else
+
+class group {
+  ctrl_t ctrl_[group_width];
+
+  template <typename Pred>
+  group_mask match_if(Pred pred) const {
+    uint32_t res = 0;
+    for (std::size_t i = 0; i != group_width; ++i)
+      res |= static_cast<uint32_t>(pred(ctrl_[i])) << i;
+    return group_mask(res);
+  }
+
+ public:
+  explicit group(const ctrl_t* p) { std::memcpy(ctrl_, p, group_width); }
+
+  group_mask match(ctrl_t h2) const {
+    return match_if([h2](ctrl_t c) { return c == h2; });
+  }
+
+  group_mask match_empty() const { return match(ctrl_empty); }
+
+  group_mask match_empty_or_deleted() const {
+    return match_if([](ctrl_t c) { return c < 0; });
+  }
+};
+
+#endif  // __SSE2__
+
+// std::hash for integers is an identity, so the bits we split the hash into
+// have to be mixed first.
+inline std::size_t mix_hash(std::size_t h) {
+  constexpr uint64_t k = 0x9E3779B97F4A7C15ull;
+  __uint128_t m = static_cast<__uint128_t>(h) * k;
+  return static_cast<std::size_t>(m ^ (m >> 64));
+}
+
+template <typename T, typename = void>
+struct IsTransparent : std::false_type {};
+
+template <typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>>
+    : std::true_type {};
+
+// A non-deduced context would always pick the default K = key_type.
+template <bool transparent>
+struct key_arg_impl {
+  template <typename K, typename Key>
+  using type = K;
+};
+
+template <>
+struct key_arg_impl<false> {
+  template <typename K, typename Key>
+  using type = Key;
+};
+
+inline std::size_t h1(std::size_t hash) { return hash >> 7; }
+
+inline ctrl_t h2(std::size_t hash) { return static_cast<ctrl_t>(hash & 0x7f); }
+
+inline void prefetch(const void* p) {
+#if defined(__GNUC__)
+  __builtin_prefetch(p);
+#else
+  (void)p;
+#endif
+}
+
+}  // namespace detail
+
+template <typename Key, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<Key>>
+class flat_hash_set {
+  using alloc_traits = std::allocator_traits<Allocator>;
+  using ctrl_allocator =
+      typename alloc_traits::template rebind_alloc<detail::ctrl_t>;
+  using ctrl_traits = std::allocator_traits<ctrl_allocator>;
+
+ public:
+  using key_type = Key;
+  using value_type = Key;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  class const_iterator {
+    friend class flat_hash_set;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Key*;
+    using reference = const Key&;
+
+   private:
+    const detail::ctrl_t* ctrl_ = nullptr;
+    const detail::ctrl_t* end_ = nullptr;
+    const value_type* slot_ = nullptr;
+
+    const_iterator(const detail::ctrl_t* ctrl, const detail::ctrl_t* end,
+                   const value_type* slot)
+        : ctrl_(ctrl), end_(end), slot_(slot) {}
+
+    void skip_empty_or_deleted() {
+      while (ctrl_ != end_ && *ctrl_ < 0) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+   public:
+    const_iterator() = default;
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    const_iterator& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skip_empty_or_deleted();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend bool operator==(const const_iterator& x, const const_iterator& y) {
+      return x.ctrl_ == y.ctrl_;
+    }
+
+    friend bool operator!=(const const_iterator& x, const const_iterator& y) {
+      return !(x == y);
+    }
+  };
+
+  using iterator = const_iterator;
+
+ private:
+  // Capacity is a power of two (or 0). The control array has group_width
+  // extra bytes that mirror the first group, so a group can be loaded at any
+  // position without wrapping.
+  detail::ctrl_t* ctrl_ = nullptr;
+  value_type* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  size_type growth_left_ = 0;
+
+  hasher hash_;
+  key_equal eq_;
+  allocator_type alloc_;
+
+  static constexpr size_type min_capacity = detail::group_width;
+
+  // With transparent Hash and KeyEqual lookups accept any K they do.
+  static constexpr bool is_transparent =
+      detail::IsTransparent<Hash>::value &&
+      detail::IsTransparent<KeyEqual>::value;
+
+  template <typename K>
+  using key_arg =
+      typename detail::key_arg_impl<is_transparent>::template type<K, Key>;
+
+  static size_type max_load(size_type capacity) {
+    return capacity - capacity / 8;
+  }
+
+  // Moves from an element that stays alive and is destroyed by its owner.
+  static void construct_at_slot(value_type* to, value_type& from) {
+    ::new (static_cast<void*>(to)) value_type(std::move(from));
+  }
+
+  static void relocate(value_type* to, value_type* from) {
+    construct_at_slot(to, *from);
+    from->~value_type();
+  }
+
+  size_type mask() const { return capacity_ - 1; }
+
+  void set_ctrl(size_type i, detail::ctrl_t h) {
+    ctrl_[i] = h;
+    if (i < detail::group_width) ctrl_[capacity_ + i] = h;
+  }
+
+  template <typename K>
+  size_type hash_of(const K& key) const {
+    return detail::mix_hash(hash_(key));
+  }
+
+  template <typename K>
+  size_type find_index(const K& key, size_type hash) const {
+    if (!capacity_) return capacity_;
+    const auto h2 = detail::h2(hash);
+    size_type pos = detail::h1(hash) & mask();
+    detail::prefetch(slots_ + pos);
+    for (size_type step = detail::group_width;; step += detail::group_width) {
+      detail::group g{ctrl_ + pos};
+      for (auto m = g.match(h2); m; m.clear_lowest()) {
+        size_type i = (pos + m.lowest()) & mask();
+        if (eq_(slots_[i], key)) return i;
+      }
+      if (g.match_empty()) return capacity_;
+      pos = (pos + step) & mask();
+    }
+  }
+
+  size_type find_free_index(size_type hash) const {
+    size_type pos = detail::h1(hash) & mask();
+    for (size_type step = detail::group_width;; step += detail::group_width) {
+      detail::group g{ctrl_ + pos};
+      if (auto m = g.match_empty_or_deleted()) {
+        return (pos + m.lowest()) & mask();
+      }
+      pos = (pos + step) & mask();
+    }
+  }
+
+  void allocate_table(size_type capacity) {
+    ctrl_allocator ca{alloc_};
+    ctrl_ = ctrl_traits::allocate(ca, capacity + detail::group_width);
+    try {
+      slots_ = alloc_traits::allocate(alloc_, capacity);
+    } catch (...) {
+      ctrl_traits::deallocate(ca, ctrl_, capacity + detail::group_width);
+      ctrl_ = nullptr;
+      throw;
+    }
+    capacity_ = capacity;
+    growth_left_ = max_load(capacity);
+    std::memset(ctrl_, static_cast<unsigned char>(detail::ctrl_empty),
+                capacity + detail::group_width);
+  }
+
+  void deallocate_table() {
+    if (!capacity_) return;
+    ctrl_allocator ca{alloc_};
+    ctrl_traits::deallocate(ca, ctrl_, capacity_ + detail::group_width);
+    alloc_traits::deallocate(alloc_, slots_, capacity_);
+    ctrl_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+    growth_left_ = 0;
+  }
+
+  void destroy_elements() noexcept {
+    for (size_type i = 0; i != capacity_; ++i) {
+      if (ctrl_[i] >= 0) alloc_traits::destroy(alloc_, slots_ + i);
+    }
+  }
+
+  void resize(size_type new_capacity) {
+    auto* old_ctrl = ctrl_;
+    auto* old_slots = slots_;
+    auto old_capacity = capacity_;
+
+    allocate_table(new_capacity);
+    growth_left_ -= size_;
+
+    for (size_type i = 0; i != old_capacity; ++i) {
+      if (old_ctrl[i] < 0) continue;
+      auto hash = hash_of(old_slots[i]);
+      auto to = find_free_index(hash);
+      set_ctrl(to, detail::h2(hash));
+      relocate(slots_ + to, old_slots + i);
+    }
+
+    if (old_capacity) {
+      ctrl_allocator ca{alloc_};
+      ctrl_traits::deallocate(ca, old_ctrl, old_capacity + detail::group_width);
+      alloc_traits::deallocate(alloc_, old_slots, old_capacity);
+    }
+  }
+
+  void grow_if_needed() {
+    if (growth_left_) return;
+    if (!capacity_) return resize(min_capacity);
+    // Mostly tombstones: rehashing in place frees them up.
+    if (size_ * 2 < max_load(capacity_)) return resize(capacity_);
+    resize(capacity_ * 2);
+  }
+
+  // Puts an element that is not in the set yet into a free slot, where
+  // place(slot) constructs it.
+  template <typename Place>
+  const_iterator insert_unique(size_type hash, Place place) {
+    grow_if_needed();
+    auto i = find_free_index(hash);
+    place(slots_ + i);
+    if (ctrl_[i] == detail::ctrl_empty) --growth_left_;
+    set_ctrl(i, detail::h2(hash));
+    ++size_;
+    return iterator_at(i);
+  }
+
+  const_iterator iterator_at(size_type i) const {
+    return {ctrl_ + i, ctrl_ + capacity_, slots_ + i};
+  }
+
+  void steal(flat_hash_set& x) noexcept {
+    ctrl_ = std::exchange(x.ctrl_, nullptr);
+    slots_ = std::exchange(x.slots_, nullptr);
+    capacity_ = std::exchange(x.capacity_, 0);
+    size_ = std::exchange(x.size_, 0);
+    growth_left_ = std::exchange(x.growth_left_, 0);
+  }
+
+ public:
+  flat_hash_set() = default;
+
+  explicit flat_hash_set(const allocator_type& a) : alloc_(a) {}
+
+  flat_hash_set(size_type bucket_count, const hasher& hash = hasher(),
+                const key_equal& eq = key_equal(),
+                const allocator_type& a = allocator_type())
+      : hash_(hash), eq_(eq), alloc_(a) {
+    reserve(bucket_count);
+  }
+
+  // Copying would share the payloads of dependent elements.
+  flat_hash_set(const flat_hash_set&) = delete;
+  flat_hash_set& operator=(const flat_hash_set&) = delete;
+
+  flat_hash_set(flat_hash_set&& x) noexcept
+      : hash_(std::move(x.hash_)),
+        eq_(std::move(x.eq_)),
+        alloc_(std::move(x.alloc_)) {
+    steal(x);
+  }
+
+  flat_hash_set& operator=(flat_hash_set&& x) noexcept {
+    if (this == &x) return *this;
+    clear();
+    deallocate_table();
+    hash_ = std::move(x.hash_);
+    eq_ = std::move(x.eq_);
+    alloc_ = x.alloc_;
+    steal(x);
+    return *this;
+  }
+
+  ~flat_hash_set() {
+    destroy_elements();
+    deallocate_table();
+  }
+
+  allocator_type get_allocator() const { return alloc_; }
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return eq_; }
+
+  const_iterator begin() const {
+    auto it = iterator_at(0);
+    it.skip_empty_or_deleted();
+    return it;
+  }
+  const_iterator cbegin() const { return begin(); }
+
+  const_iterator end() const { return iterator_at(capacity_); }
+  const_iterator cend() const { return end(); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+  size_type bucket_count() const { return capacity_; }
+
+  float load_factor() const {
+    return capacity_ ? static_cast<float>(size_) / capacity_ : 0.0f;
+  }
+
+  void reserve(size_type count) {
+    size_type capacity = min_capacity;
+    while (max_load(capacity) < count) capacity *= 2;
+    if (capacity > capacity_) resize(capacity);
+  }
+
+  void clear() noexcept {
+    destroy_elements();
+    if (capacity_) {
+      std::memset(ctrl_, static_cast<unsigned char>(detail::ctrl_empty),
+                  capacity_ + detail::group_width);
+    }
+    size_ = 0;
+    growth_left_ = max_load(capacity_);
+    if (!capacity_) growth_left_ = 0;
+  }
+
+  template <typename K = key_type>
+  const_iterator find(const key_arg<K>& key) const {
+    return iterator_at(find_index(key, hash_of(key)));
+  }
+
+  template <typename K = key_type>
+  size_type count(const key_arg<K>& key) const {
+    return find<K>(key) != end();
+  }
+
+  template <typename K = key_type>
+  bool contains(const key_arg<K>& key) const {
+    return find<K>(key) != end();
+  }
+
+  // If the key is already present, x is left untouched, otherwise it's moved
+  // from.
+  std::pair<const_iterator, bool> insert(value_type&& x) {
+    auto hash = hash_of(x);
+    auto i = find_index(x, hash);
+    if (i != capacity_) return {iterator_at(i), false};
+    return {insert_unique(hash, [&](value_type* to) {
+              construct_at_slot(to, x);
+            }),
+            true};
+  }
+
+  // The element is constructed through the allocator before the lookup, like
+  // std::set::emplace does.
+  template <typename... Args>
+  std::pair<const_iterator, bool> emplace(Args&&... args) {
+    std::aligned_storage_t<sizeof(value_type), alignof(value_type)> buf;
+    auto* tmp = reinterpret_cast<value_type*>(&buf);
+    alloc_traits::construct(alloc_, tmp, std::forward<Args>(args)...);
+
+    auto hash = hash_of(*tmp);
+    auto i = find_index(*tmp, hash);
+    if (i != capacity_) {
+      alloc_traits::destroy(alloc_, tmp);
+      return {iterator_at(i), false};
+    }
+    try {
+      return {insert_unique(hash, [&](value_type* to) { relocate(to, tmp); }),
+              true};
+    } catch (...) {
+      alloc_traits::destroy(alloc_, tmp);
+      throw;
+    }
+  }
+
+  const_iterator erase(const_iterator pos) {
+    auto i = static_cast<size_type>(pos.ctrl_ - ctrl_);
+    alloc_traits::destroy(alloc_, slots_ + i);
+    set_ctrl(i, detail::ctrl_deleted);
+    --size_;
+    return ++pos;
+  }
+
+  template <typename K = key_type>
+  size_type erase(const key_arg<K>& key) {
+    auto it = find<K>(key);
+    if (it == end()) return 0;
+    erase(it);
+    return 1;
+  }
+
+  void swap(flat_hash_set& x) noexcept {
+    using std::swap;
+    swap(ctrl_, x.ctrl_);
+    swap(slots_, x.slots_);
+    swap(capacity_, x.capacity_);
+    swap(size_, x.size_);
+    swap(growth_left_, x.growth_left_);
+    swap(hash_, x.hash_);
+    swap(eq_, x.eq_);
+    swap(alloc_, x.alloc_);
+  }
+};
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_FLAT_HASH_SET_H_
@@ -1,3 +1,6 @@
+#ifndef _FUTURE_STD_STUBS_H_
+#define _FUTURE_STD_STUBS_H_
+
 #include <cstdint>
 #include <iterator>
 
@@ -58,4 +61,6 @@ using basic_string_view = detail::span_impl<Char, 1>;
 
 using string_view = basic_string_view<char>;
 
-}  // namespace future_std_stubs
\ No newline at end of file
+}  // namespace future_std_stubs
+
+#endif  // _FUTURE_STD_STUBS_H_
@@ -0,0 +1,324 @@
+#ifndef _DEPENDENT_LIB_GROWABLE_VECTOR_H_
+#define _DEPENDENT_LIB_GROWABLE_VECTOR_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "dependent/compare.h"
+#include "dependent/dependent.h"
+#include "dependent/hash.h"
+
+// A dependent vector that can grow.
+//
+// Like vector it is a single pointer and doesn't keep its allocator: every
+// call that may allocate or free takes it as an argument. The size and the
+// capacity are stored in front of the payload:
+//
+//   [size | capacity | e0 e1 ... e(size - 1) | unused capacity]
+//
+// An empty growable_vector that never allocated is a null pointer. Allocators
+// with try_expand (like dense_allocator_handler) let it grow in place.
+
+namespace dependent_lib {
+
+namespace detail {
+
+struct growable_header {
+  std::size_t size;
+  std::size_t capacity;
+};
+
+// Moves [f, l) to uninitialized memory at out and ends the lifetime of the
+// source elements. This doesn't go through the allocator, so moved-from
+// dependent elements don't free the payload they've just handed over.
+template <typename T>
+void relocate(T* f, T* l, T* out) noexcept {
+  if constexpr (std::is_trivially_copyable<T>::value) {
+    if (f != l) std::memcpy(out, f, (l - f) * sizeof(T));
+  } else {
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "relocation can't be undone");
+    for (; f != l; ++f, ++out) {
+      ::new (static_cast<void*>(out)) T(std::move(*f));
+      f->~T();
+    }
+  }
+}
+
+}  // namespace detail
+
+template <typename T, typename Alloc>
+class growable_vector {
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using header = detail::growable_header;
+
+  static constexpr std::ptrdiff_t header_space =
+      (sizeof(header) + sizeof(T) - 1) / sizeof(T);
+
+  T* data_ = nullptr;
+
+  header read_header() const noexcept {
+    header h{0, 0};
+    if (data_) std::memcpy(&h, static_cast<const void*>(data_), sizeof(h));
+    return h;
+  }
+
+  void write_size(std::size_t size) noexcept {
+    std::memcpy(static_cast<void*>(data_), &size, sizeof(size));
+  }
+
+  static std::size_t allocation_size(std::size_t capacity) noexcept {
+    return header_space + capacity;
+  }
+
+  // Allocates a buffer for capacity elements with this vector's size.
+  T* allocate_buffer(Alloc& a, std::size_t size, std::size_t capacity) {
+    T* res = &*alloc_traits::allocate(a, allocation_size(capacity));
+    header h{size, capacity};
+    std::memcpy(static_cast<void*>(res), &h, sizeof(h));
+    return res;
+  }
+
+  void deallocate_buffer(Alloc& a, T* buffer) noexcept {
+    header h;
+    std::memcpy(&h, static_cast<const void*>(buffer), sizeof(h));
+    alloc_traits::deallocate(a, buffer, allocation_size(h.capacity));
+  }
+
+  std::size_t next_capacity(std::size_t required) const noexcept {
+    return std::max({required, 2 * capacity(), std::size_t{4}});
+  }
+
+  // Extends the current buffer in place if the allocator supports it.
+  bool try_expand(Alloc& a, std::size_t capacity) {
+    if (!data_) return false;
+    const auto h = read_header();
+    if (!detail::try_expand(a, data_, allocation_size(h.capacity),
+                            allocation_size(capacity)))
+      return false;
+    header new_h{h.size, capacity};
+    std::memcpy(static_cast<void*>(data_), &new_h, sizeof(new_h));
+    return true;
+  }
+
+  // Moves the elements to a new buffer of the given capacity.
+  void reallocate(Alloc& a, std::size_t capacity) {
+    if (try_expand(a, capacity)) return;
+    const auto size = this->size();
+    T* buffer = allocate_buffer(a, size, capacity);
+    if (data_) {
+      detail::relocate(begin(), end(), buffer + header_space);
+      deallocate_buffer(a, data_);
+    }
+    data_ = buffer;
+  }
+
+ public:
+  using allocator_type = Alloc;
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using span_type = span<const T>;
+
+  growable_vector() noexcept = default;
+
+  growable_vector(std::allocator_arg_t, allocator_type) noexcept {}
+
+  template <typename I, typename = std::enable_if_t<ForwardIterator<I>>>
+  growable_vector(std::allocator_arg_t, allocator_type a, I f, I l) {
+    insert(a, end(), f, l);
+  }
+
+  template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
+  growable_vector(std::allocator_arg_t, allocator_type a, R&& r)
+      : growable_vector(std::allocator_arg, a,
+                        detail::range_begin<T, Alloc, R>(r),
+                        detail::range_end<T, Alloc, R>(r)) {}
+
+  growable_vector(std::allocator_arg_t, allocator_type, growable_vector&& rhs)
+      : growable_vector(std::move(rhs)) {}
+
+  size_type size() const noexcept { return read_header().size; }
+  size_type capacity() const noexcept { return read_header().capacity; }
+  bool empty() const noexcept { return size() == 0; }
+
+  T* data() noexcept { return data_ ? data_ + header_space : nullptr; }
+  const T* data() const noexcept {
+    return data_ ? data_ + header_space : nullptr;
+  }
+
+  iterator begin() noexcept { return data(); }
+  iterator end() noexcept { return data() + size(); }
+  const_iterator begin() const noexcept { return data(); }
+  const_iterator end() const noexcept { return data() + size(); }
+
+  T& operator[](size_type i) noexcept { return data()[i]; }
+  const T& operator[](size_type i) const noexcept { return data()[i]; }
+
+  T& back() noexcept { return end()[-1]; }
+  const T& back() const noexcept { return end()[-1]; }
+
+  span_type as_span() const noexcept { return {begin(), end()}; }
+
+  void reserve(allocator_type a, size_type capacity) {
+    if (capacity > this->capacity()) reallocate(a, capacity);
+  }
+
+  template <typename... Args>
+  T& emplace_back(allocator_type a, Args&&... args) {
+    const auto h = read_header();
+    if (h.size == h.capacity && !try_expand(a, next_capacity(h.size + 1))) {
+      // The argument may refer to an element, so it's constructed before the
+      // old elements are moved.
+      const auto capacity = next_capacity(h.size + 1);
+      T* buffer = allocate_buffer(a, h.size, capacity);
+      T* new_begin = buffer + header_space;
+      try {
+        alloc_traits::construct(a, new_begin + h.size,
+                                std::forward<Args>(args)...);
+      } catch (...) {
+        alloc_traits::deallocate(a, buffer, allocation_size(capacity));
+        throw;
+      }
+      if (data_) {
+        detail::relocate(begin(), end(), new_begin);
+        deallocate_buffer(a, data_);
+      }
+      data_ = buffer;
+    } else {
+      alloc_traits::construct(a, data() + h.size, std::forward<Args>(args)...);
+    }
+    write_size(h.size + 1);
+    return back();
+  }
+
+  void push_back(allocator_type a, const T& x) { emplace_back(a, x); }
+  void push_back(allocator_type a, T&& x) { emplace_back(a, std::move(x)); }
+
+  void pop_back(allocator_type a) noexcept {
+    assert(!empty());
+    alloc_traits::destroy(a, end() - 1);
+    write_size(size() - 1);
+  }
+
+  // New elements are value initialized.
+  void resize(allocator_type a, size_type n) {
+    const auto size = this->size();
+    if (n <= size) {
+      detail::destroy(begin() + n, end(), a);
+      if (data_) write_size(n);
+      return;
+    }
+    if (n > capacity()) reallocate(a, next_capacity(n));
+    T* f = end();
+    T* cur = f;
+    try {
+      for (; cur != begin() + n; ++cur) alloc_traits::construct(a, cur);
+    } catch (...) {
+      detail::destroy(f, cur, a);
+      throw;
+    }
+    write_size(n);
+  }
+
+  // [f, l) must not point into this vector.
+  template <typename I, typename = std::enable_if_t<ForwardIterator<I>>>
+  iterator insert(allocator_type a, const_iterator pos, I f, I l) {
+    const auto offset = pos - begin();
+    const auto old_size = size();
+    const auto n = static_cast<size_type>(std::distance(f, l));
+    if (n == 0) return begin() + offset;
+    if (old_size + n > capacity()) reallocate(a, next_capacity(old_size + n));
+
+    T* old_end = end();
+    T* cur = old_end;
+    if constexpr (detail::BulkCopyIteratorImpl<T, Alloc, I>::value) {
+      std::memcpy(cur, detail::iterator_base(f), n * sizeof(T));
+      cur += n;
+    } else {
+      try {
+        for (; f != l; ++f, ++cur) alloc_traits::construct(a, cur, *f);
+      } catch (...) {
+        detail::destroy(old_end, cur, a);
+        throw;
+      }
+    }
+    write_size(old_size + n);
+    std::rotate(begin() + offset, old_end, cur);
+    return begin() + offset;
+  }
+
+  template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
+  iterator insert(allocator_type a, const_iterator pos, R&& r) {
+    return insert(a, pos, detail::range_begin<T, Alloc, R>(r),
+                  detail::range_end<T, Alloc, R>(r));
+  }
+
+  void clear(allocator_type a) noexcept { resize(a, 0); }
+
+  // Gives the unused capacity back.
+  void shrink_to_fit(allocator_type a) {
+    if (!data_ || size() == capacity()) return;
+    if (empty()) {
+      destroy(a);
+      return;
+    }
+    reallocate(a, size());
+  }
+
+  void destroy(allocator_type a) {
+    if (!data_) return;
+    detail::destroy(begin(), end(), a);
+    deallocate_buffer(a, data_);
+    data_ = nullptr;
+  }
+
+  friend bool operator==(const growable_vector& x, const growable_vector& y) {
+    return detail::equal(x.begin(), x.end(), y.begin(), y.end());
+  }
+
+  friend bool operator!=(const growable_vector& x, const growable_vector& y) {
+    return !(x == y);
+  }
+
+  friend bool operator<(const growable_vector& x, const growable_vector& y) {
+    return detail::lexicographical_compare(x.begin(), x.end(), y.begin(),
+                                           y.end());
+  }
+
+  friend bool operator>(const growable_vector& x, const growable_vector& y) {
+    return y < x;
+  }
+
+  friend bool operator<=(const growable_vector& x, const growable_vector& y) {
+    return !(x > y);
+  }
+
+  friend bool operator>=(const growable_vector& x, const growable_vector& y) {
+    return !(x < y);
+  }
+};
+
+}  // namespace dependent_lib
+
+namespace std {
+
+template <typename T, typename Alloc>
+struct hash<dependent_lib::growable_vector<T, Alloc>> {
+  std::size_t operator()(
+      const dependent_lib::growable_vector<T, Alloc>& x) const noexcept {
+    return dependent_lib::detail::hash_span(x.begin(), x.end());
+  }
+};
+
+}  // namespace std
+
+#endif  // _DEPENDENT_LIB_GROWABLE_VECTOR_H_
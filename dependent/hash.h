@@ -0,0 +1,143 @@
+#ifndef _DEPENDENT_LIB_HASH_H_
+#define _DEPENDENT_LIB_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#include "dependent/future_std_stubs.h"
+
+namespace dependent_lib {
+
+namespace detail {
+
+// wyhash (final version 4, public domain, github.com/wangyi-fudan/wyhash).
+//
+// Long inputs run three independent 64x64->128 multiply lanes over 48 byte
+// stripes, short inputs (most keys) are read with a couple of overlapping
+// loads. There is no target specific code path, so every build hashes the
+// same bytes to the same value.
+namespace wy {
+
+constexpr uint64_t secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+inline void mum(uint64_t* a, uint64_t* b) noexcept {
+  __uint128_t r = *a;
+  r *= *b;
+  *a = static_cast<uint64_t>(r);
+  *b = static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) noexcept {
+  mum(&a, &b);
+  return a ^ b;
+}
+
+inline uint64_t read8(const unsigned char* p) noexcept {
+  uint64_t v;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t read4(const unsigned char* p) noexcept {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+inline uint64_t read3(const unsigned char* p, std::size_t k) noexcept {
+  return (static_cast<uint64_t>(p[0]) << 16) |
+         (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+}  // namespace wy
+
+inline uint64_t hash_bytes(const void* key, std::size_t len,
+                           uint64_t seed = 0) noexcept {
+  using namespace wy;
+  auto* p = static_cast<const unsigned char*>(key);
+  seed ^= mix(seed ^ secret[0], secret[1]);
+  uint64_t a, b;
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+      b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = read3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    std::size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+        see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+        see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  mum(&a, &b);
+  return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+// Elements hashed as raw bytes: scalars without padding and with a single
+// representation per value. Class types are hashed through std::hash even
+// then, as equal dependent vectors point to different payloads.
+template <typename T>
+constexpr bool bitwise_hashable =
+    std::has_unique_object_representations<T>::value &&
+    (std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+     std::is_pointer<T>::value);
+
+// Hashes the contents of [f, l).
+// Bitwise hashable elements are hashed as raw bytes, so equal contents hash
+// equally whatever container holds them.
+template <typename T>
+std::size_t hash_span(const T* f, const T* l) noexcept {
+  if constexpr (bitwise_hashable<T>) {
+    return hash_bytes(f, static_cast<std::size_t>(l - f) * sizeof(T));
+  } else {
+    std::size_t res = static_cast<std::size_t>(l - f);
+    for (; f != l; ++f)
+      res ^= std::hash<T>{}(*f) + 0x9e3779b9 + (res << 6) + (res >> 2);
+    return res;
+  }
+}
+
+}  // namespace detail
+
+}  // namespace dependent_lib
+
+namespace std {
+
+// Covers span and string_view.
+template <typename T, int tag>
+struct hash<future_std_stubs::detail::span_impl<T, tag>> {
+  std::size_t operator()(
+      const future_std_stubs::detail::span_impl<T, tag>& x) const noexcept {
+    return dependent_lib::detail::hash_span<std::remove_const_t<T>>(x.begin(),
+                                                                    x.end());
+  }
+};
+
+}  // namespace std
+
+#endif  // _DEPENDENT_LIB_HASH_H_
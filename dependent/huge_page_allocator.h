@@ -0,0 +1,184 @@
+#ifndef _DEPENDENT_LIB_HUGE_PAGE_ALLOCATOR_H_
+#define _DEPENDENT_LIB_HUGE_PAGE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/mman.h>
+
+// Backing allocator for dense_allocators that takes memory from the kernel in
+// big regions backed by huge pages, so a multi-gigabyte arena needs few TLB
+// entries.
+//
+// huge_page_pool maps regions with mmap and carves the arena's blocks out of
+// them. It first asks for explicit huge pages (MAP_HUGETLB), then for
+// transparent huge pages (madvise(MADV_HUGEPAGE)), then settles for normal
+// pages. mode() reports what the kernel gave. Transparent huge pages count
+// only if /sys/kernel/mm/transparent_hugepage/enabled allows them for
+// madvised memory, as madvise succeeds either way; khugepaged may still
+// leave some of the memory in normal pages.
+//
+// Linux only.
+
+namespace dependent_lib {
+
+enum class huge_page_mode {
+  normal,       // 4 KiB pages.
+  transparent,  // madvise(MADV_HUGEPAGE), promoted by khugepaged.
+  hugetlb,      // MAP_HUGETLB, reserved in /proc/sys/vm/nr_hugepages.
+};
+
+class huge_page_pool {
+ public:
+  static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+  // region_size is rounded up to huge pages. prefered is the best mode to
+  // try; the pool falls back to the next ones.
+  explicit huge_page_pool(
+      std::size_t region_size = 64 * huge_page_size,
+      huge_page_mode prefered = huge_page_mode::hugetlb)
+      : region_size_(round_up(region_size, huge_page_size)),
+        prefered_(prefered) {}
+
+  huge_page_pool(const huge_page_pool&) = delete;
+  huge_page_pool& operator=(const huge_page_pool&) = delete;
+
+  ~huge_page_pool() {
+    for (auto& r : regions_) ::munmap(r.first, r.second);
+  }
+
+  // The worst mode of the regions mapped so far, prefered if there are none.
+  huge_page_mode mode() const noexcept { return mode_; }
+
+  // Whether the kernel backs madvise(MADV_HUGEPAGE) memory with transparent
+  // huge pages: the enabled setting is "always" or "madvise", not "never".
+  // Read once.
+  static bool transparent_huge_pages_enabled() {
+    static const bool res = [] {
+      std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+      std::string setting;
+      std::getline(in, setting);
+      return setting.find("[always]") != std::string::npos ||
+             setting.find("[madvise]") != std::string::npos;
+    }();
+    return res;
+  }
+
+  std::size_t mapped_size() const noexcept {
+    std::size_t res = 0;
+    for (auto& r : regions_) res += r.second;
+    return res;
+  }
+
+  void* allocate(std::size_t size, std::size_t alignment) {
+    // Requests of more than half a region get their own mapping, so they can
+    // be unmapped when they're deallocated.
+    if (is_dedicated(size)) return map(round_up(size, huge_page_size));
+
+    auto cur = round_up(reinterpret_cast<uintptr_t>(tail_), alignment);
+    if (cur + size > reinterpret_cast<uintptr_t>(end_)) {
+      tail_ = static_cast<char*>(map(region_size_));
+      end_ = tail_ + region_size_;
+      regions_.emplace_back(tail_, region_size_);
+      cur = reinterpret_cast<uintptr_t>(tail_);
+    }
+    tail_ = reinterpret_cast<char*>(cur + size);
+    return reinterpret_cast<void*>(cur);
+  }
+
+  // Memory carved from regions is given back when the pool is destroyed.
+  void deallocate(void* p, std::size_t size) noexcept {
+    if (is_dedicated(size)) ::munmap(p, round_up(size, huge_page_size));
+  }
+
+ private:
+  std::size_t region_size_;
+  huge_page_mode prefered_;
+  huge_page_mode mode_ = prefered_;
+  char* tail_ = nullptr;
+  char* end_ = nullptr;
+  std::vector<std::pair<void*, std::size_t>> regions_;
+
+  static constexpr std::size_t round_up(std::size_t x, std::size_t to) {
+    return (x + to - 1) / to * to;
+  }
+
+  bool is_dedicated(std::size_t size) const noexcept {
+    return size > region_size_ / 2;
+  }
+
+  void* map(std::size_t size) {
+    constexpr int prot = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (prefered_ == huge_page_mode::hugetlb) {
+#ifdef MAP_HUGETLB
+      void* p = ::mmap(nullptr, size, prot, flags | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) return p;
+#endif
+    }
+
+    void* p = ::mmap(nullptr, size, prot, flags, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+
+    auto obtained = huge_page_mode::normal;
+#ifdef MADV_HUGEPAGE
+    if (prefered_ != huge_page_mode::normal &&
+        ::madvise(p, size, MADV_HUGEPAGE) == 0 &&
+        transparent_huge_pages_enabled())
+      obtained = huge_page_mode::transparent;
+#endif
+    if (obtained < mode_) mode_ = obtained;
+    return p;
+  }
+};
+
+// A handle to a huge_page_pool, to be used as the backing allocator of
+// dense_allocators.
+template <typename T>
+class huge_page_allocator {
+  template <typename U>
+  friend class huge_page_allocator;
+
+  huge_page_pool* pool_;
+
+ public:
+  using value_type = T;
+
+  explicit huge_page_allocator(huge_page_pool* pool) noexcept : pool_(pool) {}
+
+  template <typename U>
+  huge_page_allocator(const huge_page_allocator<U>& x) noexcept
+      : pool_(x.pool_) {}
+
+  huge_page_pool* pool() const noexcept { return pool_; }
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(pool_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    pool_->deallocate(p, n * sizeof(T));
+  }
+
+  template <typename U>
+  friend bool operator==(const huge_page_allocator& x,
+                         const huge_page_allocator<U>& y) {
+    return x.pool() == y.pool();
+  }
+
+  template <typename U>
+  friend bool operator!=(const huge_page_allocator& x,
+                         const huge_page_allocator<U>& y) {
+    return !(x == y);
+  }
+};
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_HUGE_PAGE_ALLOCATOR_H_
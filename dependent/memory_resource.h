@@ -0,0 +1,208 @@
+#ifndef _DEPENDENT_LIB_MEMORY_RESOURCE_H_
+#define _DEPENDENT_LIB_MEMORY_RESOURCE_H_
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <utility>
+
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
+#include "dependent/slab_allocator.h"
+
+// std::pmr::memory_resource on top of dense and slab allocators, so std::pmr
+// containers and dependent containers can share one arena.
+//
+// dense_memory_resource picks one of the single allocators of a
+// dense_allocators for every request: the first one aligned enough whose
+// size divides the request, otherwise the smallest one aligned enough,
+// rounding the request up. Requests no single allocator is aligned for go to
+// the upstream resource. slab_memory_resource passes size and alignment on
+// to slab_allocators.
+//
+// dependent_lib::pmr::vector is a dependent vector with a
+// polymorphic_allocator, wrapped in allocator_adaptor like every other
+// dependent vector allocator.
+
+namespace dependent_lib {
+
+template <typename DenseAllocators>
+class dense_memory_resource;
+
+template <typename Policy, typename Alloc, typename... Ts>
+class dense_memory_resource<basic_dense_allocators<Policy, Alloc, Ts...>>
+    : public std::pmr::memory_resource {
+ public:
+  using arena_type = basic_dense_allocators<Policy, Alloc, Ts...>;
+
+  explicit dense_memory_resource(
+      arena_type* arena,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : arena_(arena), upstream_(upstream) {}
+
+  dense_memory_resource(const dense_memory_resource&) = delete;
+  dense_memory_resource& operator=(const dense_memory_resource&) = delete;
+
+  arena_type* arena() const noexcept { return arena_; }
+  std::pmr::memory_resource* upstream_resource() const noexcept {
+    return upstream_;
+  }
+
+  // Index in Ts of the single allocator serving a request, sizeof...(Ts) for
+  // the upstream resource.
+  static constexpr std::size_t select(std::size_t bytes,
+                                      std::size_t alignment) noexcept {
+    constexpr std::size_t sizes[] = {sizeof(Ts)...};
+    constexpr std::size_t alignments[] = {alignof(Ts)...};
+    std::size_t res = sizeof...(Ts);
+    for (std::size_t i = 0; i != sizeof...(Ts); ++i) {
+      if (alignments[i] < alignment) continue;
+      if (bytes % sizes[i] == 0) return i;
+      if (res == sizeof...(Ts) || sizes[i] < sizes[res]) res = i;
+    }
+    return res;
+  }
+
+ private:
+  using types = std::tuple<Ts...>;
+
+  template <std::size_t I>
+  using single_allocator = typename arena_type::template single_allocator_for<
+      std::tuple_element_t<I, types>>;
+
+  template <std::size_t I>
+  static constexpr std::size_t cages(std::size_t bytes) noexcept {
+    constexpr std::size_t size = sizeof(std::tuple_element_t<I, types>);
+    return bytes ? (bytes + size - 1) / size : 1;
+  }
+
+  template <std::size_t... I>
+  void* allocate_impl(std::size_t i, std::size_t bytes,
+                      std::index_sequence<I...>) {
+    void* res = nullptr;
+    ((i == I && (res = static_cast<single_allocator<I>&>(*arena_).allocate(
+                     cages<I>(bytes)))) ||
+     ...);
+    return res;
+  }
+
+  template <std::size_t... I>
+  void deallocate_impl(std::size_t i, void* p, std::size_t bytes,
+                       std::index_sequence<I...>) {
+    ((i == I && (static_cast<single_allocator<I>&>(*arena_).deallocate(
+                     p, cages<I>(bytes)),
+                 true)) ||
+     ...);
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    const auto i = select(bytes, alignment);
+    if (i == sizeof...(Ts)) return upstream_->allocate(bytes, alignment);
+    return allocate_impl(i, bytes, std::index_sequence_for<Ts...>{});
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    const auto i = select(bytes, alignment);
+    if (i == sizeof...(Ts)) {
+      upstream_->deallocate(p, bytes, alignment);
+      return;
+    }
+    deallocate_impl(i, p, bytes, std::index_sequence_for<Ts...>{});
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  arena_type* arena_;
+  std::pmr::memory_resource* upstream_;
+};
+
+template <typename SlabAllocators>
+class slab_memory_resource : public std::pmr::memory_resource {
+ public:
+  using arena_type = SlabAllocators;
+
+  explicit slab_memory_resource(
+      arena_type* arena,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : arena_(arena), upstream_(upstream) {}
+
+  slab_memory_resource(const slab_memory_resource&) = delete;
+  slab_memory_resource& operator=(const slab_memory_resource&) = delete;
+
+  arena_type* arena() const noexcept { return arena_; }
+  std::pmr::memory_resource* upstream_resource() const noexcept {
+    return upstream_;
+  }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    if (alignment > detail::cache_line_size)
+      return upstream_->allocate(bytes, alignment);
+    return arena_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    if (alignment > detail::cache_line_size) {
+      upstream_->deallocate(p, bytes, alignment);
+      return;
+    }
+    arena_->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  arena_type* arena_;
+  std::pmr::memory_resource* upstream_;
+};
+
+namespace detail {
+
+// polymorphic_allocator without uses-allocator construction of its own:
+// allocator_adaptor already passes itself to the elements, and elements
+// would get both allocators otherwise.
+template <typename T>
+struct pmr_allocator : std::pmr::polymorphic_allocator<T> {
+  using std::pmr::polymorphic_allocator<T>::polymorphic_allocator;
+
+  template <typename U>
+  struct rebind {
+    using other = pmr_allocator<U>;
+  };
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  pmr_allocator select_on_container_copy_construction() const noexcept {
+    return pmr_allocator();
+  }
+};
+
+}  // namespace detail
+
+namespace pmr {
+
+template <typename T>
+using allocator = allocator_adaptor<detail::pmr_allocator<T>>;
+
+template <typename T, typename Header = size_prefix_header>
+using leaky_vector = dependent_lib::leaky_vector<T, allocator<T>, Header>;
+
+template <typename T, typename Header = size_prefix_header>
+using vector = dependent_lib::vector<T, allocator<T>, Header>;
+
+}  // namespace pmr
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_MEMORY_RESOURCE_H_
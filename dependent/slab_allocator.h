@@ -0,0 +1,258 @@
+#ifndef _DEPENDENT_LIB_SLAB_ALLOCATOR_H_
+#define _DEPENDENT_LIB_SLAB_ALLOCATOR_H_
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include "dependent/dense_allocator.h"
+
+// Dense allocators for types that aren't known up front.
+//
+// dense_allocators needs the sizes and alignments of everything it serves
+// in its template arguments, which for container nodes means guessing them
+// with unknown_type. slab_allocators picks a size class at runtime instead:
+// every 8 bytes up to 64, then four classes per power of two (80, 96, 112,
+// 128, 160, ...). Each class is a dense arena created on the first request
+// of its size. Requests bigger than the biggest class, a quarter of
+// Policy::max_block_size, go to a separate arena of cache lines.
+//
+// Alignments up to a cache line are supported. A class serves an alignment
+// if its size is a multiple of it.
+
+namespace dependent_lib {
+
+namespace detail {
+
+constexpr std::size_t slab_granularity = 8;
+
+// Size classes in bytes.
+constexpr std::size_t slab_class_of(std::size_t bytes) noexcept {
+  if (bytes <= 64) return (std::max(bytes, std::size_t{1}) - 1) / 8;
+  const std::size_t k = 63 - __builtin_clzll(bytes - 1);
+  const std::size_t base = std::size_t{1} << k;
+  return 8 + 4 * (k - 6) + (bytes - 1 - base) / (base / 4);
+}
+
+constexpr std::size_t slab_class_size(std::size_t c) noexcept {
+  if (c < 8) return 8 * (c + 1);
+  const std::size_t base = std::size_t{64} << ((c - 8) / 4);
+  return base + ((c - 8) % 4 + 1) * (base / 4);
+}
+
+// Class arenas of a slab allocator only bump and roll back, the slab keeps
+// its own free lists. The large arena keeps Policy as is and reuses freed
+// allocations through its own free lists if Policy asks for it.
+template <typename Policy>
+struct slab_arena_policy : Policy {
+  static constexpr bool reuse_freed = false;
+};
+
+}  // namespace detail
+
+template <typename Policy, typename Alloc>
+class basic_slab_allocators {
+  using arena_policy = detail::slab_arena_policy<Policy>;
+  using class_arena =
+      detail::single_dense_allocator<detail::slab_granularity,
+                                     detail::slab_granularity, Alloc,
+                                     arena_policy>;
+  using large_arena =
+      detail::single_dense_allocator<detail::cache_line_size,
+                                     detail::cache_line_size, Alloc, Policy>;
+
+  static constexpr std::size_t max_class_bytes =
+      std::max(Policy::max_block_size / 4, std::size_t{64});
+
+ public:
+  using policy_type = Policy;
+  using backing_allocator_type = Alloc;
+
+  static constexpr std::size_t class_count =
+      detail::slab_class_of(max_class_bytes) +
+      (detail::slab_class_size(detail::slab_class_of(max_class_bytes)) <=
+       max_class_bytes);
+
+ private:
+  struct slab {
+    // Created on the first allocation of the class.
+    std::optional<class_arena> arena;
+    // Freed allocations of the class, linked through their first bytes.
+    void* free_head = nullptr;
+  };
+
+  backing_allocator_type backing_allocator_;
+  std::array<slab, class_count> slabs_;
+  large_arena large_;
+
+  static constexpr std::size_t large_cages(std::size_t bytes) noexcept {
+    return (bytes + detail::cache_line_size - 1) / detail::cache_line_size;
+  }
+
+  // class_count for requests that go to the large arena.
+  static std::size_t class_of(std::size_t bytes,
+                              std::size_t alignment) noexcept {
+    auto c = detail::slab_class_of(std::max(bytes, alignment));
+    while (c < class_count && detail::slab_class_size(c) % alignment) ++c;
+    return std::min(c, class_count);
+  }
+
+ public:
+  explicit basic_slab_allocators(const backing_allocator_type& a)
+      : backing_allocator_(a), large_(a) {}
+
+  basic_slab_allocators(const basic_slab_allocators&) = delete;
+  basic_slab_allocators& operator=(const basic_slab_allocators&) = delete;
+
+  const backing_allocator_type& backing_allocator() const noexcept {
+    return backing_allocator_;
+  }
+
+  // Number of size classes that have taken memory so far.
+  std::size_t used_classes() const noexcept {
+    return std::count_if(slabs_.begin(), slabs_.end(),
+                         [](const slab& s) { return s.arena.has_value(); });
+  }
+
+  static constexpr std::size_t class_size(std::size_t c) noexcept {
+    return detail::slab_class_size(c);
+  }
+
+  // Stats of a size class, empty if it was never used.
+  dense_allocator_stats class_stats(std::size_t c) const noexcept {
+    const auto& s = slabs_[c];
+    if (!s.arena) return {};
+    auto res = s.arena->stats();
+    for (void* cur = s.free_head; cur; std::memcpy(&cur, cur, sizeof(void*))) {
+      res.free_list_bytes += class_size(c);
+      res.used_bytes -= class_size(c);
+    }
+    return res;
+  }
+
+  // All the classes and the large arena.
+  dense_allocator_stats total_stats() const noexcept {
+    auto res = large_.stats();
+    for (std::size_t c = 0; c != class_count; ++c) res += class_stats(c);
+    return res;
+  }
+
+  void* allocate(std::size_t bytes, std::size_t alignment) {
+    const auto c = class_of(bytes, alignment);
+    if (c == class_count) return large_.allocate(large_cages(bytes));
+
+    auto& s = slabs_[c];
+    if (void* p = s.free_head) {
+      std::memcpy(&s.free_head, p, sizeof(void*));
+      return p;
+    }
+    if (!s.arena) s.arena.emplace(backing_allocator_);
+    return s.arena->allocate(detail::slab_class_size(c) /
+                             detail::slab_granularity);
+  }
+
+  // The most recent allocation of a class is given back to its arena, others
+  // go to the free list of the class if the Policy asks for it.
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    const auto c = class_of(bytes, alignment);
+    if (c == class_count) {
+      large_.deallocate(p, large_cages(bytes));
+      return;
+    }
+
+    auto& s = slabs_[c];
+    const auto cages = detail::slab_class_size(c) / detail::slab_granularity;
+    if (s.arena->try_expand(p, cages, 0)) return;
+    if constexpr (Policy::reuse_freed) {
+      std::memcpy(p, &s.free_head, sizeof(void*));
+      s.free_head = p;
+    }
+  }
+
+  // Succeeds while the new size stays in the class of the allocation, or
+  // for the most recent large allocation.
+  bool try_expand(void* p, std::size_t old_bytes, std::size_t new_bytes,
+                  std::size_t alignment) {
+    const auto c = class_of(old_bytes, alignment);
+    if (c != class_count) return class_of(new_bytes, alignment) == c;
+    if (class_of(new_bytes, alignment) != class_count) return false;
+    return large_.try_expand(p, large_cages(old_bytes), large_cages(new_bytes));
+  }
+};
+
+template <typename Alloc>
+using slab_allocators = basic_slab_allocators<default_dense_policy, Alloc>;
+
+// Slab allocators that reuse freed memory, for containers with erase/insert
+// churn.
+template <typename Alloc>
+using reusing_slab_allocators =
+    basic_slab_allocators<reusing_dense_policy, Alloc>;
+
+template <typename T, typename SlabAllocator>
+class slab_allocator_handler {
+  static_assert(alignof(T) <= detail::cache_line_size,
+                "slab allocators align to a cache line at most");
+
+  template <typename U, typename A>
+  friend class slab_allocator_handler;
+
+  SlabAllocator* slab_allocator_;
+
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = slab_allocator_handler<U, SlabAllocator>;
+  };
+
+  explicit slab_allocator_handler(SlabAllocator* slab_allocator)
+      : slab_allocator_(slab_allocator) {}
+  slab_allocator_handler(const slab_allocator_handler&) = default;
+  slab_allocator_handler& operator=(const slab_allocator_handler&) = default;
+  ~slab_allocator_handler() = default;
+
+  template <typename U, typename = std::enable_if_t<!std::is_same<U, T>::value>>
+  slab_allocator_handler(const slab_allocator_handler<U, SlabAllocator>& x)
+      : slab_allocator_(x.slab_allocator_) {}
+
+  template <typename U, typename = std::enable_if_t<!std::is_same<U, T>::value>>
+  slab_allocator_handler& operator=(
+      const slab_allocator_handler<U, SlabAllocator>& x) {
+    slab_allocator_ = x.slab_allocator_;
+    return *this;
+  }
+
+  T* allocate(std::size_t size) {
+    return static_cast<T*>(
+        slab_allocator_->allocate(size * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t size) {
+    slab_allocator_->deallocate(p, size * sizeof(T), alignof(T));
+  }
+
+  // Resizes an allocation without moving it, see detail::try_expand.
+  bool try_expand(T* p, std::size_t old_size, std::size_t new_size) {
+    return slab_allocator_->try_expand(p, old_size * sizeof(T),
+                                       new_size * sizeof(T), alignof(T));
+  }
+
+  friend bool operator==(const slab_allocator_handler& x,
+                         const slab_allocator_handler& y) {
+    return x.slab_allocator_ == y.slab_allocator_;
+  }
+
+  friend bool operator!=(const slab_allocator_handler& x,
+                         const slab_allocator_handler& y) {
+    return !(x == y);
+  }
+};
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_SLAB_ALLOCATOR_H_
@@ -0,0 +1,160 @@
+#ifndef _DEPENDENT_LIB_SMALL_VECTOR_H_
+#define _DEPENDENT_LIB_SMALL_VECTOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "dependent/compare.h"
+#include "dependent/dependent.h"
+#include "dependent/hash.h"
+
+// A dependent vector that keeps small payloads inside its 8 byte handle.
+//
+// User space pointers on x86-64 (and on aarch64 without top byte tagging)
+// leave the top byte zero. small_vector uses that byte as a tag: when its high
+// bit is set the low bits hold the size and the other 7 bytes hold the
+// elements, otherwise the handle is a plain leaky_vector pointing to an
+// allocated payload.
+//
+//   inline: [e0 e1 e2 e3 e4 e5 e6 | 0x80 + size]
+//   heap:   [pointer to leaky_vector payload     ]
+
+namespace dependent_lib {
+
+template <typename T, typename Alloc, typename Header = size_prefix_header>
+class small_vector {
+  using heap_type = detail::leaky_vector<T, span<const T>, Alloc, Header>;
+  using alloc_traits = std::allocator_traits<Alloc>;
+
+  static_assert(sizeof(heap_type) == 8, "small_vector needs 64 bit pointers");
+  static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+                "the tag byte has to be the top byte of the pointer");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "inline elements are copied as bytes");
+
+  static constexpr std::size_t tag_index = sizeof(heap_type) - 1;
+  static constexpr unsigned char inline_tag = 0x80;
+
+  alignas(heap_type) unsigned char storage_[sizeof(heap_type)];
+
+  heap_type& heap() noexcept {
+    return *std::launder(reinterpret_cast<heap_type*>(storage_));
+  }
+
+  const heap_type& heap() const noexcept {
+    return *std::launder(reinterpret_cast<const heap_type*>(storage_));
+  }
+
+  template <typename I>
+  void construct_inline(I f, std::size_t size) {
+    std::memset(storage_, 0, sizeof(storage_));
+    T* out = reinterpret_cast<T*>(storage_);
+    for (std::size_t i = 0; i != size; ++i, ++f) out[i] = *f;
+    storage_[tag_index] = static_cast<unsigned char>(inline_tag | size);
+  }
+
+ public:
+  using allocator_type = Alloc;
+  using span_type = span<const T>;
+
+  static constexpr std::size_t inline_capacity = tag_index / sizeof(T);
+
+  template <typename I, typename = std::enable_if_t<ForwardIterator<I>>>
+  small_vector(std::allocator_arg_t, allocator_type a, I f, I l) {
+    auto dist = static_cast<std::size_t>(std::distance(f, l));
+    if (dist <= inline_capacity) {
+      construct_inline(f, dist);
+      return;
+    }
+    ::new (static_cast<void*>(storage_)) heap_type(std::allocator_arg, a, f, l);
+    assert(!is_inline() && "pointer uses the top byte");
+  }
+
+  template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
+  small_vector(std::allocator_arg_t, allocator_type a, R&& r)
+      : small_vector(std::allocator_arg, a,
+                     detail::range_begin<T, Alloc, R>(r),
+                     detail::range_end<T, Alloc, R>(r)) {}
+
+  small_vector(std::allocator_arg_t, allocator_type, small_vector&& rhs)
+      : small_vector(std::move(rhs)) {}
+
+  bool is_inline() const noexcept {
+    return (storage_[tag_index] & inline_tag) != 0;
+  }
+
+  std::size_t size() const noexcept {
+    if (is_inline()) return storage_[tag_index] & ~inline_tag;
+    return heap().size();
+  }
+
+  // For inline payloads the span points into the handle itself.
+  span_type as_span() const noexcept {
+    if (is_inline()) {
+      const T* f = reinterpret_cast<const T*>(storage_);
+      return {f, f + size()};
+    }
+    return heap().as_span();
+  }
+
+  void destroy(allocator_type a) {
+    if (is_inline()) return;
+    auto& h = heap();
+    T *f, *l;
+    std::tie(f, l) = h.begin_end();
+    detail::destroy(f, l, a);
+    alloc_traits::deallocate(a, h.data_, h.required_allocation_size(l - f));
+    construct_inline(f, 0);
+  }
+
+  friend bool operator==(const small_vector& x, const small_vector& y) {
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return detail::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+  }
+
+  friend bool operator!=(const small_vector& x, const small_vector& y) {
+    return !(x == y);
+  }
+
+  friend bool operator<(const small_vector& x, const small_vector& y) {
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return detail::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
+                                           ys.end());
+  }
+
+  friend bool operator>(const small_vector& x, const small_vector& y) {
+    return y < x;
+  }
+
+  friend bool operator<=(const small_vector& x, const small_vector& y) {
+    return !(x > y);
+  }
+
+  friend bool operator>=(const small_vector& x, const small_vector& y) {
+    return !(x < y);
+  }
+};
+
+}  // namespace dependent_lib
+
+namespace std {
+
+template <typename T, typename Alloc, typename Header>
+struct hash<dependent_lib::small_vector<T, Alloc, Header>> {
+  std::size_t operator()(
+      const dependent_lib::small_vector<T, Alloc, Header>& x) const noexcept {
+    auto sp = x.as_span();
+    return dependent_lib::detail::hash_span(sp.begin(), sp.end());
+  }
+};
+
+}  // namespace std
+
+#endif  // _DEPENDENT_LIB_SMALL_VECTOR_H_
@@ -0,0 +1,175 @@
+#ifndef _DEPENDENT_LIB_STRING_HANDLE_H_
+#define _DEPENDENT_LIB_STRING_HANDLE_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "dependent/compare.h"
+#include "dependent/dependent.h"
+#include "dependent/hash.h"
+
+// A 16 byte string handle in the style of Umbra/German strings.
+//
+// The handle keeps the size and the first 4 elements next to the payload, so
+// most comparisons are decided without touching the payload memory. Strings of
+// up to 12 elements are stored in the handle, longer ones in a regular
+// leaky_vector allocation.
+//
+//   short: [size | e0 e1 e2 e3 | e4 ... e11                 ]
+//   long:  [size | e0 e1 e2 e3 | pointer to leaky_vector payload]
+
+namespace dependent_lib {
+
+template <typename T, typename Alloc, typename Header = size_prefix_header>
+class alignas(8) string_handle {
+  using heap_type = detail::leaky_vector<T, span<const T>, Alloc, Header>;
+  using alloc_traits = std::allocator_traits<Alloc>;
+
+  static_assert(sizeof(T) == 1 && detail::bitwise_equality_comparable<T>,
+                "string_handle holds byte sized integral elements");
+  static_assert(sizeof(heap_type) == 8, "string_handle needs 64 bit pointers");
+
+  static constexpr std::size_t prefix_size = 4;
+
+  uint32_t size_;
+  alignas(4) unsigned char bytes_[prefix_size + sizeof(heap_type)];
+
+  heap_type& heap() noexcept {
+    return *std::launder(reinterpret_cast<heap_type*>(bytes_ + prefix_size));
+  }
+
+  const heap_type& heap() const noexcept {
+    return *std::launder(
+        reinterpret_cast<const heap_type*>(bytes_ + prefix_size));
+  }
+
+  // The prefix as a big endian number, with its elements mapped so that
+  // numeric order is element order and elements past the size are zero.
+  uint32_t prefix_key() const noexcept {
+    uint32_t raw;
+    std::memcpy(&raw, bytes_, prefix_size);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    raw = __builtin_bswap32(raw);
+#endif
+    if constexpr (std::is_signed<T>::value) raw ^= 0x80808080u;
+    if (size_ < prefix_size) raw &= ~(0xffffffffu >> (8 * size_));
+    return raw;
+  }
+
+ public:
+  using allocator_type = Alloc;
+  using span_type = span<const T>;
+
+  static constexpr std::size_t inline_capacity = sizeof(bytes_);
+
+  template <typename I, typename = std::enable_if_t<ForwardIterator<I>>>
+  string_handle(std::allocator_arg_t, allocator_type a, I f, I l) {
+    auto dist = std::distance(f, l);
+    assert(static_cast<uint64_t>(dist) <= std::numeric_limits<uint32_t>::max());
+    size_ = static_cast<uint32_t>(dist);
+    std::memset(bytes_, 0, sizeof(bytes_));
+    if (size_ <= inline_capacity) {
+      T* out = reinterpret_cast<T*>(bytes_);
+      for (; f != l; ++f, ++out) *out = *f;
+      return;
+    }
+    heap_type* h = ::new (static_cast<void*>(bytes_ + prefix_size))
+        heap_type(std::allocator_arg, a, f, l);
+    std::memcpy(bytes_, h->as_span().begin(), prefix_size);
+  }
+
+  template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
+  string_handle(std::allocator_arg_t, allocator_type a, R&& r)
+      : string_handle(std::allocator_arg, a, detail::range_begin<T, Alloc, R>(r),
+                      detail::range_end<T, Alloc, R>(r)) {}
+
+  string_handle(std::allocator_arg_t, allocator_type, string_handle&& rhs)
+      : string_handle(std::move(rhs)) {}
+
+  bool is_inline() const noexcept { return size_ <= inline_capacity; }
+
+  std::size_t size() const noexcept { return size_; }
+
+  span_type as_span() const noexcept {
+    if (is_inline()) {
+      const T* f = reinterpret_cast<const T*>(bytes_);
+      return {f, f + size_};
+    }
+    return heap().as_span();
+  }
+
+  void destroy(allocator_type a) {
+    if (is_inline()) return;
+    auto& h = heap();
+    T *f, *l;
+    std::tie(f, l) = h.begin_end();
+    detail::destroy(f, l, a);
+    alloc_traits::deallocate(a, h.data_, h.required_allocation_size(l - f));
+    size_ = 0;
+    std::memset(bytes_, 0, sizeof(bytes_));
+  }
+
+  friend bool operator==(const string_handle& x, const string_handle& y) {
+    if (x.size_ != y.size_ ||
+        std::memcmp(x.bytes_, y.bytes_, prefix_size) != 0)
+      return false;
+    if (x.size_ <= prefix_size) return true;
+    if (x.is_inline())
+      return std::memcmp(x.bytes_, y.bytes_, x.size_) == 0;
+    return std::memcmp(x.heap().as_span().begin() + prefix_size,
+                       y.heap().as_span().begin() + prefix_size,
+                       x.size_ - prefix_size) == 0;
+  }
+
+  friend bool operator!=(const string_handle& x, const string_handle& y) {
+    return !(x == y);
+  }
+
+  friend bool operator<(const string_handle& x, const string_handle& y) {
+    auto xk = x.prefix_key();
+    auto yk = y.prefix_key();
+    if (xk != yk) return xk < yk;
+    if (x.size_ <= prefix_size || y.size_ <= prefix_size)
+      return x.size_ < y.size_;
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return detail::lexicographical_compare(xs.begin() + prefix_size, xs.end(),
+                                           ys.begin() + prefix_size, ys.end());
+  }
+
+  friend bool operator>(const string_handle& x, const string_handle& y) {
+    return y < x;
+  }
+
+  friend bool operator<=(const string_handle& x, const string_handle& y) {
+    return !(x > y);
+  }
+
+  friend bool operator>=(const string_handle& x, const string_handle& y) {
+    return !(x < y);
+  }
+};
+
+}  // namespace dependent_lib
+
+namespace std {
+
+template <typename T, typename Alloc, typename Header>
+struct hash<dependent_lib::string_handle<T, Alloc, Header>> {
+  std::size_t operator()(
+      const dependent_lib::string_handle<T, Alloc, Header>& x) const noexcept {
+    auto sp = x.as_span();
+    return dependent_lib::detail::hash_span(sp.begin(), sp.end());
+  }
+};
+
+}  // namespace std
+
+#endif  // _DEPENDENT_LIB_STRING_HANDLE_H_
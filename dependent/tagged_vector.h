@@ -0,0 +1,163 @@
+#ifndef _DEPENDENT_LIB_TAGGED_VECTOR_H_
+#define _DEPENDENT_LIB_TAGGED_VECTOR_H_
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#include "dependent/compare.h"
+#include "dependent/dependent.h"
+#include "dependent/hash.h"
+
+// A dependent vector that keeps its size in the unused high bits of its
+// pointer.
+//
+// User space addresses on x86-64 Linux (with 4 level paging) fit in 48 bits.
+// tagged_vector stores sizes below 0xffff in the top 16 bits and the payload
+// without any header, so size() and as_span() don't touch memory. Bigger
+// payloads get a regular Header in front and 0xffff in the top bits.
+//
+//   small: [size (16 bits) | pointer to payload (48 bits)        ]
+//   big:   [0xffff         | pointer to Header, then payload     ]
+
+namespace dependent_lib {
+
+template <typename T, typename Alloc, typename Header = size_prefix_header>
+class tagged_vector {
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using small_type = detail::leaky_vector<T, span<const T>, Alloc,
+                                          no_size_header>;
+  using big_type = detail::leaky_vector<T, span<const T>, Alloc, Header>;
+
+  static_assert(sizeof(void*) == 8, "tagged_vector needs 64 bit pointers");
+  static_assert(std::is_pointer<typename alloc_traits::pointer>::value,
+                "the pointer has to be stored as an integer");
+  static_assert(Header::stores_size, "big sizes are stored in the header");
+
+  static constexpr int size_shift = 48;
+  static constexpr uintptr_t pointer_mask = (uintptr_t{1} << size_shift) - 1;
+  static constexpr std::size_t big_size_marker = 0xffff;
+
+  uintptr_t bits_;
+
+  T* data() const noexcept {
+    return reinterpret_cast<T*>(bits_ & pointer_mask);
+  }
+
+  std::size_t size_bits() const noexcept { return bits_ >> size_shift; }
+
+  void pack(T* data, std::size_t size_bits) noexcept {
+    auto raw = reinterpret_cast<uintptr_t>(data);
+    assert((raw & ~pointer_mask) == 0 && "pointer uses the high bits");
+    bits_ = raw | (static_cast<uintptr_t>(size_bits) << size_shift);
+  }
+
+ public:
+  using allocator_type = Alloc;
+  using span_type = span<const T>;
+
+  template <typename I, typename = std::enable_if_t<ForwardIterator<I>>>
+  tagged_vector(std::allocator_arg_t, allocator_type a, I f, I l) {
+    auto dist = static_cast<std::size_t>(std::distance(f, l));
+    if (dist < big_size_marker) {
+      small_type v(std::allocator_arg, a, f, l);
+      pack(&*v.data_, dist);
+    } else {
+      big_type v(std::allocator_arg, a, f, l);
+      pack(&*v.data_, big_size_marker);
+    }
+  }
+
+  template <typename R, typename = std::enable_if_t<ForwardRange<R>>>
+  tagged_vector(std::allocator_arg_t, allocator_type a, R&& r)
+      : tagged_vector(std::allocator_arg, a,
+                      detail::range_begin<T, Alloc, R>(r),
+                      detail::range_end<T, Alloc, R>(r)) {}
+
+  tagged_vector(std::allocator_arg_t, allocator_type, tagged_vector&& rhs)
+      : tagged_vector(std::move(rhs)) {}
+
+  // Sizes below 0xffff are known without reading the payload.
+  bool is_small() const noexcept { return size_bits() != big_size_marker; }
+
+  std::size_t size() const noexcept {
+    auto n = size_bits();
+    if (n != big_size_marker) return n;
+    auto p = Header::begin_end(static_cast<const T*>(data()));
+    return p.second - p.first;
+  }
+
+  span_type as_span() const noexcept {
+    const T* f = data();
+    auto n = size_bits();
+    if (n != big_size_marker) return {f, f + n};
+    auto p = Header::begin_end(f);
+    return {p.first, p.second};
+  }
+
+  void destroy(allocator_type a) {
+    T* f = data();
+    auto n = size_bits();
+    if (n != big_size_marker) {
+      detail::destroy(f, f + n, a);
+      alloc_traits::deallocate(a, f, n);
+    } else {
+      auto p = Header::begin_end(static_cast<const T*>(f));
+      auto big_size = p.second - p.first;
+      detail::destroy(const_cast<T*>(p.first), const_cast<T*>(p.second), a);
+      alloc_traits::deallocate(
+          a, f, Header::template required_space_in_types<T>(big_size));
+    }
+    bits_ = 0;
+  }
+
+  friend bool operator==(const tagged_vector& x, const tagged_vector& y) {
+    if (x.size_bits() != y.size_bits()) return false;
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return detail::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+  }
+
+  friend bool operator!=(const tagged_vector& x, const tagged_vector& y) {
+    return !(x == y);
+  }
+
+  friend bool operator<(const tagged_vector& x, const tagged_vector& y) {
+    auto xs = x.as_span();
+    auto ys = y.as_span();
+    return detail::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
+                                           ys.end());
+  }
+
+  friend bool operator>(const tagged_vector& x, const tagged_vector& y) {
+    return y < x;
+  }
+
+  friend bool operator<=(const tagged_vector& x, const tagged_vector& y) {
+    return !(x > y);
+  }
+
+  friend bool operator>=(const tagged_vector& x, const tagged_vector& y) {
+    return !(x < y);
+  }
+};
+
+}  // namespace dependent_lib
+
+namespace std {
+
+template <typename T, typename Alloc, typename Header>
+struct hash<dependent_lib::tagged_vector<T, Alloc, Header>> {
+  std::size_t operator()(
+      const dependent_lib::tagged_vector<T, Alloc, Header>& x) const noexcept {
+    auto sp = x.as_span();
+    return dependent_lib::detail::hash_span(sp.begin(), sp.end());
+  }
+};
+
+}  // namespace std
+
+#endif  // _DEPENDENT_LIB_TAGGED_VECTOR_H_
@@ -0,0 +1,116 @@
+#ifndef _DEPENDENT_LIB_TRANSPARENT_H_
+#define _DEPENDENT_LIB_TRANSPARENT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "dependent/compare.h"
+#include "dependent/dependent.h"
+#include "dependent/future_std_stubs.h"
+#include "dependent/hash.h"
+
+// Transparent hash and comparison functors.
+//
+// Every argument is projected to a span of its elements, so dependent vectors
+// can be looked up by spans, string views and contiguous ranges without
+// building (and allocating) a temporary dependent vector.
+//
+//   std::set<vec_t, dependent_lib::span_less, alloc> s;
+//   s.find(std::string_view("abc"));
+//   s.find("abc");
+
+namespace dependent_lib {
+
+namespace detail {
+
+template <typename T, typename = void>
+struct HasAsSpanImpl : std::false_type {};
+
+template <typename T>
+struct HasAsSpanImpl<T, void_t<decltype(std::declval<const T&>().as_span())>>
+    : std::true_type {};
+
+// Dependent vectors.
+template <typename T, typename = std::enable_if_t<HasAsSpanImpl<T>::value>>
+auto key_span(const T& x) noexcept {
+  auto sp = x.as_span();
+  using value_type = std::remove_const_t<typename decltype(sp)::value_type>;
+  return span<const value_type>{sp.begin(), sp.end()};
+}
+
+// Spans and string views from future_std_stubs.
+template <typename T, int tag>
+auto key_span(const future_std_stubs::detail::span_impl<T, tag>& x) noexcept {
+  return span<const std::remove_const_t<T>>{x.begin(), x.end()};
+}
+
+// std::string_view, std::basic_string, std::vector, std::array, C arrays
+// other than strings.
+template <typename R,
+          typename = std::enable_if_t<!HasAsSpanImpl<R>::value &&
+                                      ContiguousRangeImpl<R>::value>,
+          typename = void>
+auto key_span(const R& r) noexcept {
+  using value_type =
+      std::remove_const_t<std::remove_pointer_t<decltype(std::data(r))>>;
+  const value_type* f = std::data(r);
+  return span<const value_type>{f, f + std::size(r)};
+}
+
+template <typename C>
+constexpr bool is_character =
+    std::is_same<C, char>::value || std::is_same<C, wchar_t>::value ||
+    std::is_same<C, char16_t>::value || std::is_same<C, char32_t>::value;
+
+// Character arrays are strings, like for std::string_view: they end at the
+// first NUL, so s.find("abc") finds "abc".
+template <typename C, std::size_t N,
+          typename = std::enable_if_t<is_character<C>>>
+auto key_span(const C (&r)[N]) noexcept {
+  return span<const C>{r, std::find(r, r + N, C())};
+}
+
+}  // namespace detail
+
+struct span_hash {
+  using is_transparent = void;
+
+  template <typename K>
+  std::size_t operator()(const K& k) const noexcept {
+    if constexpr (detail::HasAsSpanImpl<K>::value) {
+      return detail::hash_vector(k);
+    } else {
+      auto sp = detail::key_span(k);
+      return detail::hash_span(sp.begin(), sp.end());
+    }
+  }
+};
+
+struct span_equal_to {
+  using is_transparent = void;
+
+  template <typename K1, typename K2>
+  bool operator()(const K1& x, const K2& y) const noexcept {
+    auto xs = detail::key_span(x);
+    auto ys = detail::key_span(y);
+    return detail::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+  }
+};
+
+struct span_less {
+  using is_transparent = void;
+
+  template <typename K1, typename K2>
+  bool operator()(const K1& x, const K2& y) const noexcept {
+    auto xs = detail::key_span(x);
+    auto ys = detail::key_span(y);
+    return detail::lexicographical_compare(xs.begin(), xs.end(), ys.begin(),
+                                           ys.end());
+  }
+};
+
+}  // namespace dependent_lib
+
+#endif  // _DEPENDENT_LIB_TRANSPARENT_H_
@@ -0,0 +1,397 @@
+#include "dependent/compaction.h"
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
+#include "dependent/transparent.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+std::string as_string(dependent_lib::span<const char> sp) {
+  return std::string(sp.begin(), sp.end());
+}
+
+// Throws once left reaches 0, counts the bytes allocated.
+struct allocation_budget {
+  static inline int left = -1;
+  static inline std::size_t live = 0;
+};
+
+template <typename T>
+struct budget_allocator {
+  using value_type = T;
+
+  budget_allocator() = default;
+  template <typename U>
+  budget_allocator(const budget_allocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    if (allocation_budget::left == 0) throw std::bad_alloc();
+    if (allocation_budget::left > 0) --allocation_budget::left;
+    allocation_budget::live += n * sizeof(T);
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    allocation_budget::live -= n * sizeof(T);
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  friend bool operator==(const budget_allocator&, const budget_allocator&) {
+    return true;
+  }
+  friend bool operator!=(const budget_allocator&, const budget_allocator&) {
+    return false;
+  }
+};
+
+TEST_CASE("compact_map_of_vectors", "[compaction]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators = dependent_lib::dense_allocators<
+      backing_allocator, char, dependent_lib::unknown_type<48, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using map_handle =
+      dependent_lib::allocator_adaptor<dependent_lib::dense_allocator_handler<
+          std::pair<const vec_t, vec_t>, dense_allocators>>;
+  using map_t = std::map<vec_t, vec_t, dependent_lib::span_less, map_handle>;
+
+  {
+    dense_allocators allocs(backing_allocator{});
+    map_t m(&allocs);
+    for (int i = 0; i < 10'000; ++i)
+      m.emplace(std::to_string(i), std::string(i % 100, 'v'));
+    // Erased payloads are dead memory in the middle of the blocks.
+    for (int i = 0; i < 10'000; ++i) {
+      if (i % 10) m.erase(m.find(std::to_string(i)));
+    }
+    REQUIRE(m.size() == 1000);
+
+    const auto used = stats::total_allocated_size();
+    const auto blocks_before = allocs.stats()[0].block_bytes;
+    const auto reclaimed = dependent_lib::compact<char>(allocs, m);
+    REQUIRE(reclaimed > blocks_before / 2);
+    REQUIRE(stats::total_allocated_size() == used - reclaimed);
+    REQUIRE(allocs.stats()[0].block_bytes == blocks_before - reclaimed);
+
+    for (int i = 0; i < 10'000; i += 10) {
+      auto it = m.find(std::to_string(i));
+      REQUIRE(it != m.end());
+      REQUIRE(as_string(it->second.as_span()) == std::string(i % 100, 'v'));
+    }
+    // Still a working arena.
+    m.emplace(std::string("new"), std::string("value"));
+    REQUIRE(as_string(m.find(std::string("new"))->second.as_span()) ==
+            "value");
+    m.clear();
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("compact_keeps_old_blocks_on_failure", "[compaction]") {
+  using dense_allocators = dependent_lib::dense_allocators<
+      budget_allocator<char>, char, dependent_lib::unknown_type<48, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using map_handle =
+      dependent_lib::allocator_adaptor<dependent_lib::dense_allocator_handler<
+          std::pair<const vec_t, vec_t>, dense_allocators>>;
+  using map_t = std::map<vec_t, vec_t, dependent_lib::span_less, map_handle>;
+
+  auto check = [](const map_t& m) {
+    REQUIRE(m.size() == 2000);
+    for (int i = 0; i < 2000; ++i) {
+      auto it = m.find(std::to_string(i));
+      REQUIRE(it != m.end());
+      REQUIRE(as_string(it->second.as_span()) == std::string(i % 100, 'v'));
+    }
+  };
+
+  {
+    dense_allocators allocs(budget_allocator<char>{});
+    map_t m(&allocs);
+    for (int i = 0; i < 2000; ++i)
+      m.emplace(std::to_string(i), std::string(i % 100, 'v'));
+
+    // Runs out of blocks half way.
+    allocation_budget::left = 2;
+    REQUIRE_THROWS_AS(dependent_lib::compact<char>(allocs, m), std::bad_alloc);
+    allocation_budget::left = -1;
+    check(m);
+
+    m.emplace(std::string("new"), std::string("value"));
+    m.erase(m.find(std::string("new")));
+    dependent_lib::compact<char>(allocs, m);
+    check(m);
+  }
+  REQUIRE(allocation_budget::live == 0);
+}
+
+TEST_CASE("compact_nested_vectors", "[compaction]") {
+  using dense_allocators =
+      dependent_lib::dense_allocators<std::allocator<char>, char,
+                                      dependent_lib::unknown_type<8, 8>>;
+  using inner_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using inner_t = dependent_lib::vector<char, inner_handle>;
+  using outer_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<inner_t, dense_allocators>>;
+  using outer_t = dependent_lib::vector<inner_t, outer_handle>;
+
+  dense_allocators allocs(std::allocator<char>{});
+  outer_handle a(&allocs);
+  inner_handle garbage_allocator(&allocs);
+  const std::string garbage(50, 'g');
+  std::vector<outer_t> v;
+  for (int i = 0; i < 200; ++i) {
+    // Lost between the live payloads.
+    for (int j = 0; j < 5; ++j)
+      inner_t(std::allocator_arg, garbage_allocator, garbage);
+    std::vector<std::string> words(i % 10, std::to_string(i));
+    v.emplace_back(std::allocator_arg, a, words);
+  }
+
+  REQUIRE(dependent_lib::compact<char>(allocs, v) > 0);
+  for (int i = 0; i < 200; ++i) {
+    auto outer = v[i].as_span();
+    REQUIRE(outer.size() == static_cast<std::size_t>(i % 10));
+    for (const auto& inner : outer)
+      REQUIRE(as_string(inner.as_span()) == std::to_string(i));
+  }
+}
+
+TEST_CASE("relayout_map_in_key_order", "[compaction]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators = dependent_lib::basic_dense_allocators<
+      dependent_lib::reusing_dense_policy, backing_allocator, char,
+      dependent_lib::unknown_type<48, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using map_handle =
+      dependent_lib::allocator_adaptor<dependent_lib::dense_allocator_handler<
+          std::pair<const vec_t, vec_t>, dense_allocators>>;
+  using map_t = std::map<vec_t, vec_t, dependent_lib::span_less, map_handle>;
+
+  // Addresses going down, at most once per block.
+  auto descents = [](const std::vector<const void*>& addresses) {
+    std::size_t res = 0;
+    for (std::size_t i = 1; i < addresses.size(); ++i)
+      res += addresses[i] < addresses[i - 1];
+    return res;
+  };
+
+  {
+    dense_allocators allocs(backing_allocator{});
+    map_t m(&allocs);
+    std::vector<int> keys(5000);
+    for (int i = 0; i < 5000; ++i) keys[i] = 10'000 + i;
+    std::mt19937 gen(42);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    for (int k : keys) m.emplace(std::to_string(k), std::string(k % 50, 'v'));
+
+    dependent_lib::relayout(allocs, m);
+    REQUIRE(m.size() == 5000);
+
+    std::vector<const void*> nodes, payloads;
+    int expected = 10'000;
+    for (const auto& [k, v] : m) {
+      REQUIRE(as_string(k.as_span()) == std::to_string(expected));
+      REQUIRE(as_string(v.as_span()) == std::string(expected % 50, 'v'));
+      ++expected;
+      nodes.push_back(&k);
+      payloads.push_back(&*k.as_span().begin());
+    }
+    const auto blocks = allocs.stats();
+    REQUIRE(descents(nodes) < blocks[1].blocks);
+    REQUIRE(descents(payloads) < blocks[0].blocks);
+
+    // Hottest first.
+    const auto hot = std::to_string(14'999);
+    dependent_lib::relayout(allocs, m, [&](const auto& x) {
+      return as_string(x.first.as_span()) == hot ? 100 : 0;
+    });
+    REQUIRE(&m.begin()->first > &m.rbegin()->first);
+    REQUIRE(&*m.rbegin()->first.as_span().begin() <
+            &*m.begin()->first.as_span().begin());
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("relayout_keeps_container_on_failure", "[compaction]") {
+  using dense_allocators = dependent_lib::dense_allocators<
+      budget_allocator<char>, char, dependent_lib::unknown_type<40, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using set_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<vec_t, dense_allocators>>;
+  using set_t = std::set<vec_t, dependent_lib::span_less, set_handle>;
+
+  auto check = [](const set_t& s) {
+    REQUIRE(s.size() == 2000);
+    for (int i = 0; i < 2000; ++i) REQUIRE(s.count(std::to_string(i)) == 1);
+  };
+
+  {
+    dense_allocators allocs(budget_allocator<char>{});
+    set_t s(&allocs);
+    for (int i = 0; i < 2000; ++i) s.emplace(std::to_string(i));
+
+    // Runs out of blocks half way.
+    allocation_budget::left = 3;
+    REQUIRE_THROWS_AS(dependent_lib::relayout(allocs, s), std::bad_alloc);
+    allocation_budget::left = -1;
+    check(s);
+
+    dependent_lib::relayout(allocs, s);
+    check(s);
+  }
+  REQUIRE(allocation_budget::live == 0);
+}
+
+TEST_CASE("relayout_set_reclaims_erased", "[compaction]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators = dependent_lib::dense_allocators<
+      backing_allocator, char, dependent_lib::unknown_type<40, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using set_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<vec_t, dense_allocators>>;
+  using set_t = std::set<vec_t, dependent_lib::span_less, set_handle>;
+
+  {
+    dense_allocators allocs(backing_allocator{});
+    set_t s(&allocs);
+    for (int i = 0; i < 5000; ++i) s.emplace(std::string(i % 200, 'a' + i % 7));
+    for (auto it = s.begin(); it != s.end();) {
+      it = it->as_span().size() % 4 ? s.erase(it) : std::next(it);
+    }
+    const auto size = s.size();
+    const auto used = stats::total_allocated_size();
+    const auto reclaimed = dependent_lib::relayout(allocs, s);
+    REQUIRE(reclaimed > 0);
+    REQUIRE(stats::total_allocated_size() == used - reclaimed);
+    REQUIRE(s.size() == size);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("clone_map_of_vectors", "[compaction]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators =
+      dependent_lib::dense_allocators<backing_allocator, char>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  // Nodes outside of the arena, payloads in it.
+  using map_t = std::map<vec_t, vec_t, dependent_lib::span_less>;
+  static_assert(
+      !dependent_lib::detail::allocates_in<map_t, dense_allocators>::value,
+      "");
+  // A map with its nodes in the arena doesn't compile: clone() would copy
+  // the nodes with memcpy and leave them pointing into the old blocks.
+  using arena_map_t = std::map<
+      vec_t, vec_t, dependent_lib::span_less,
+      dependent_lib::allocator_adaptor<dependent_lib::dense_allocator_handler<
+          std::pair<const vec_t, vec_t>, dense_allocators>>>;
+  static_assert(
+      dependent_lib::detail::allocates_in<arena_map_t, dense_allocators>::value,
+      "");
+
+  {
+    dense_allocators copy_allocs(backing_allocator{});
+    map_t copy;
+    {
+      dense_allocators allocs(backing_allocator{});
+      vec_t_handle a(&allocs);
+      map_t m;
+      for (int i = 0; i < 1000; ++i) {
+        m.emplace(vec_t(std::allocator_arg, a, std::to_string(i)),
+                  vec_t(std::allocator_arg, a, std::string(i % 30, 'v')));
+      }
+      // Too big for a block.
+      m.emplace(vec_t(std::allocator_arg, a, std::string("large")),
+                vec_t(std::allocator_arg, a, std::string(10'000, 'l')));
+
+      const auto used = stats::total_allocated_size();
+      copy = dependent_lib::clone(allocs, copy_allocs, m);
+      REQUIRE(stats::total_allocated_size() == 2 * used);
+      REQUIRE(copy_allocs.total_stats().block_bytes ==
+              allocs.total_stats().block_bytes);
+      REQUIRE(copy_allocs.total_stats().used_bytes ==
+              allocs.total_stats().used_bytes);
+      REQUIRE(copy_allocs.total_stats().large_allocations == 1);
+    }
+    // The original arena is gone.
+    REQUIRE(copy.size() == 1001);
+    for (int i = 0; i < 1000; ++i) {
+      auto it = copy.find(std::to_string(i));
+      REQUIRE(it != copy.end());
+      REQUIRE(as_string(it->second.as_span()) == std::string(i % 30, 'v'));
+    }
+    REQUIRE(as_string(copy.find(std::string("large"))->second.as_span()) ==
+            std::string(10'000, 'l'));
+
+    // The copy is a working arena.
+    vec_t_handle a(&copy_allocs);
+    vec_t x(std::allocator_arg, a, std::string("more"));
+    REQUIRE(as_string(x.as_span()) == "more");
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("clone_nested_vectors", "[compaction]") {
+  using dense_allocators = dependent_lib::basic_dense_allocators<
+      dependent_lib::growing_dense_policy, std::allocator<char>, char,
+      dependent_lib::unknown_type<8, 8>>;
+  using inner_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using inner_t = dependent_lib::vector<char, inner_handle>;
+  using outer_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<inner_t, dense_allocators>>;
+  using outer_t = dependent_lib::vector<inner_t, outer_handle>;
+
+  dense_allocators allocs(std::allocator<char>{});
+  outer_handle a(&allocs);
+  std::vector<std::string> words;
+  for (int i = 0; i < 10'000; ++i) words.push_back(std::to_string(i));
+  outer_t v(std::allocator_arg, a, words);
+
+  dense_allocators copy_allocs(std::allocator<char>{});
+  outer_t copy = dependent_lib::clone(allocs, copy_allocs, v);
+  REQUIRE(&*copy.as_span().begin() != &*v.as_span().begin());
+
+  // Nothing is shared: overwrite the original.
+  v.update_elements([&](inner_t& w) {
+    w.update_elements([](char& c) { c = 'x'; });
+  });
+  auto sp = copy.as_span();
+  REQUIRE(sp.size() == 10'000);
+  int i = 0;
+  for (const auto& w : sp)
+    REQUIRE(as_string(w.as_span()) == std::to_string(i++));
+}
+
+}  // namespace
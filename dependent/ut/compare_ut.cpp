@@ -0,0 +1,79 @@
+#include "dependent/compare.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "catch/catch.h"
+
+namespace {
+
+template <typename T>
+void compare_like_std(std::mt19937& gen) {
+  std::uniform_int_distribution<int> len(0, 80);
+  std::uniform_int_distribution<int> value(-3, 3);
+
+  for (int round = 0; round < 2000; ++round) {
+    std::vector<T> x(len(gen));
+    for (auto& e : x) e = static_cast<T>(value(gen));
+
+    // Mostly shares a prefix with x, so mismatches land in every position.
+    std::vector<T> y(x.begin(), x.begin() + len(gen) % (x.size() + 1));
+    if (round % 3 != 0) {
+      for (int extra = len(gen) % 5; extra; --extra)
+        y.push_back(static_cast<T>(value(gen)));
+    }
+
+    const T* xf = x.data();
+    const T* xl = xf + x.size();
+    const T* yf = y.data();
+    const T* yl = yf + y.size();
+
+    REQUIRE(dependent_lib::detail::equal(xf, xl, yf, yl) ==
+            std::equal(xf, xl, yf, yl));
+    REQUIRE(dependent_lib::detail::equal(xf, xl, xf, xl));
+    REQUIRE(dependent_lib::detail::lexicographical_compare(xf, xl, yf, yl) ==
+            std::lexicographical_compare(xf, xl, yf, yl));
+    REQUIRE(dependent_lib::detail::lexicographical_compare(yf, yl, xf, xl) ==
+            std::lexicographical_compare(yf, yl, xf, xl));
+  }
+}
+
+TEST_CASE("traits", "[compare]") {
+  using namespace dependent_lib::detail;
+
+  static_assert(bitwise_ordered<unsigned char>, "");
+  static_assert(bitwise_ordered<std::byte>, "");
+  static_assert(!bitwise_ordered<signed char>, "");
+  static_assert(!bitwise_ordered<uint16_t>, "");
+
+  static_assert(bitwise_equality_comparable<int>, "");
+  static_assert(!bitwise_equality_comparable<float>, "");
+}
+
+TEST_CASE("mismatch_bytes", "[compare]") {
+  std::vector<unsigned char> x(100, 7);
+  for (std::size_t n : {0, 1, 7, 8, 15, 16, 31, 32, 33, 64, 100}) {
+    for (std::size_t pos = 0; pos <= n; ++pos) {
+      auto y = x;
+      if (pos < n) y[pos] = 8;
+      REQUIRE(dependent_lib::detail::mismatch_bytes(x.data(), y.data(), n) ==
+              pos);
+    }
+  }
+}
+
+TEST_CASE("compare_like_std", "[compare]") {
+  std::mt19937 gen(42);
+  compare_like_std<char>(gen);
+  compare_like_std<signed char>(gen);
+  compare_like_std<unsigned char>(gen);
+  compare_like_std<int16_t>(gen);
+  compare_like_std<uint16_t>(gen);
+  compare_like_std<int32_t>(gen);
+  compare_like_std<uint64_t>(gen);
+  compare_like_std<double>(gen);
+}
+
+}  // namespace
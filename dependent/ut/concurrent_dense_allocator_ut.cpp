@@ -0,0 +1,171 @@
+#include "dependent/concurrent_dense_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/dependent.h"
+#include "dependent/growable_vector.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+constexpr int thread_count = 8;
+
+TEST_CASE("concurrent_dense_allocator_threads", "[concurrent_dense_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators =
+      dependent_lib::concurrent_dense_allocators<backing_allocator, char,
+                                                 int64_t>;
+  using char_handle =
+      dependent_lib::dense_allocator_handler<char, dense_allocators>;
+  using int_handle =
+      dependent_lib::dense_allocator_handler<int64_t, dense_allocators>;
+
+  {
+    dense_allocators resourse(backing_allocator{});
+    // One handle for every thread.
+    char_handle c(&resourse);
+    int_handle i(&resourse);
+
+    std::vector<std::vector<std::pair<char*, int64_t*>>> allocations(
+        thread_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t] {
+        for (int n = 0; n < 20'000; ++n) {
+          char* x = c.allocate(n % 7 + 1);
+          std::fill(x, x + n % 7 + 1, static_cast<char>(t));
+          int64_t* y = i.allocate(1);
+          *y = t * 1'000'000 + n;
+          allocations[t].emplace_back(x, y);
+          // Too big for a block, released right away.
+          if (n % 1000 == 0) c.deallocate(c.allocate(10'000), 10'000);
+        }
+      });
+    }
+    for (auto& t : threads) t.join();
+
+    std::vector<char*> all;
+    for (int t = 0; t < thread_count; ++t) {
+      for (int n = 0; n < 20'000; ++n) {
+        auto [x, y] = allocations[t][n];
+        REQUIRE(std::all_of(x, x + n % 7 + 1,
+                            [&](char v) { return v == static_cast<char>(t); }));
+        REQUIRE(*y == t * 1'000'000 + n);
+        all.push_back(x);
+      }
+    }
+    std::sort(all.begin(), all.end());
+    REQUIRE(std::adjacent_find(all.begin(), all.end()) == all.end());
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("concurrent_dense_allocator_rollback",
+          "[concurrent_dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::concurrent_dense_allocators<std::allocator<int>, int>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+  using vec_t = dependent_lib::growable_vector<int, allocator_handle>;
+
+  dense_allocators resourse(std::allocator<int>{});
+  allocator_handle a(&resourse);
+
+  // Every thread grows its own vector at the tail of its own block.
+  std::vector<vec_t> vectors(thread_count);
+  std::vector<const int*> firsts(thread_count);
+  // Catch assertions aren't thread safe.
+  std::vector<int> rolled_back(thread_count);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t] {
+      auto& v = vectors[t];
+      v.push_back(a, t);
+      firsts[t] = v.data();
+      for (int n = 1; n < 500; ++n) v.push_back(a, t + n);
+      int* x = a.allocate(3);
+      a.deallocate(x, 3);
+      rolled_back[t] = a.allocate(3) == x;
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  for (int t = 0; t < thread_count; ++t) {
+    REQUIRE(rolled_back[t]);
+    REQUIRE(vectors[t].data() == firsts[t]);
+    for (int n = 0; n < 500; ++n) REQUIRE(vectors[t][n] == t + n);
+  }
+}
+
+TEST_CASE("concurrent_dense_allocator_foreign_pointers",
+          "[concurrent_dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::concurrent_dense_allocators<std::allocator<int>, int>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+
+  // As many arenas as a thread keeps regions in.
+  std::vector<std::unique_ptr<dense_allocators>> arenas;
+  for (int i = 0; i < 4; ++i)
+    arenas.push_back(std::make_unique<dense_allocators>(std::allocator<int>{}));
+  dense_allocators other(std::allocator<int>{});
+  allocator_handle o(&other);
+
+  std::vector<int*> tails;
+  for (auto& arena : arenas)
+    tails.push_back(allocator_handle(arena.get()).allocate(2));
+
+  // Allocated by another thread: this one has no region in other, and
+  // looking at the pointer mustn't take one from the arenas above.
+  int* p = nullptr;
+  std::thread([&] { p = o.allocate(2); }).join();
+  REQUIRE(!o.try_expand(p, 2, 3));
+  o.deallocate(p, 2);
+
+  for (std::size_t i = 0; i != arenas.size(); ++i) {
+    allocator_handle a(arenas[i].get());
+    REQUIRE(a.try_expand(tails[i], 2, 3));
+    a.deallocate(tails[i], 3);
+    REQUIRE(a.allocate(2) == tails[i]);
+  }
+}
+
+TEST_CASE("dependent_vectors_on_concurrent_dense_allocator",
+          "[concurrent_dense_allocator]") {
+  using dense_allocators = dependent_lib::concurrent_dense_allocators<
+      std::allocator<char>, char, dependent_lib::unknown_type<8, 8>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using outer_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<vec_t, dense_allocators>>;
+  using outer_t = dependent_lib::growable_vector<vec_t, outer_handle>;
+
+  dense_allocators resourse(std::allocator<char>{});
+  outer_handle a(&resourse);
+  std::vector<outer_t> parts(thread_count);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t] {
+      for (int n = 0; n < 1000; ++n)
+        parts[t].emplace_back(a, std::to_string(t * 1000 + n));
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  for (int t = 0; t < thread_count; ++t) {
+    auto sp = parts[t][999].as_span();
+    REQUIRE(std::string(sp.begin(), sp.end()) == std::to_string(t * 1000 + 999));
+  }
+}
+
+}  // namespace
@@ -1,9 +1,14 @@
 #include "dependent/dense_allocator.h"
 #include "dependent/dependent.h"
+#include "dependent/growable_vector.h"
+#include "dependent/utils/stats_allocator.h"
 
+#include <list>
 #include <map>
 #include <scoped_allocator>
 #include <set>
+#include <sstream>
+#include <vector>
 
 #include "catch/catch.h"
 
@@ -42,6 +47,149 @@ TEST_CASE("required_size_in_types", "[dependent_lib]") {
   static_assert(required_space_in_types<char>(3500) == 3501 + 16, "");
   static_assert(required_space_in_types<int32_t>(uint32_max) == uint32_max + 5,
                 "");
+
+  using dependent_lib::fixed_size_header;
+  using dependent_lib::no_size_header;
+  using dependent_lib::varint_size_header;
+
+  // varint
+  static_assert(varint_size_header::required_space_in_types<char>(0) == 1, "");
+  static_assert(varint_size_header::required_space_in_types<char>(127) == 128,
+                "");
+  static_assert(varint_size_header::required_space_in_types<char>(128) == 130,
+                "");
+  static_assert(varint_size_header::required_space_in_types<char>(256) == 258,
+                "");
+  static_assert(
+      varint_size_header::required_space_in_types<char>(16383) == 16385, "");
+  static_assert(
+      varint_size_header::required_space_in_types<char>(16384) == 16387, "");
+  static_assert(
+      varint_size_header::required_space_in_types<int16_t>(16384) == 16386,
+      "");
+  static_assert(
+      varint_size_header::required_space_in_types<int32_t>(3500) == 3501, "");
+  static_assert(
+      varint_size_header::required_space_in_types<int32_t>(uint32_max) ==
+          uint32_max + 2,
+      "");
+
+  // fixed uint32_t
+  static_assert(fixed_size_header::required_space_in_types<char>(9) == 13, "");
+  static_assert(fixed_size_header::required_space_in_types<char>(256) == 260,
+                "");
+  static_assert(fixed_size_header::required_space_in_types<int16_t>(9) == 11,
+                "");
+  static_assert(
+      fixed_size_header::required_space_in_types<int32_t>(uint32_max) ==
+          uint32_max + 1,
+      "");
+  static_assert(fixed_size_header::required_space_in_types<int64_t>(9) == 10,
+                "");
+
+  // none
+  static_assert(no_size_header::required_space_in_types<char>(256) == 256, "");
+  static_assert(no_size_header::required_space_in_types<int64_t>(9) == 9, "");
+}
+
+template <typename T, typename Header>
+void check_size_header() {
+  using vec_t = dependent_lib::vector<T, std::allocator<T>, Header>;
+  std::allocator<T> a;
+  for (std::size_t size : {0, 1, 127, 128, 255, 256, 16383, 16384, 70000}) {
+    std::vector<T> in(size);
+    for (std::size_t i = 0; i != size; ++i) in[i] = static_cast<T>(i * 7);
+    vec_t v(std::allocator_arg, a, in);
+    if constexpr (Header::stores_size) {
+      auto sp = v.as_span();
+      REQUIRE(sp.size() == size);
+      REQUIRE(std::equal(sp.begin(), sp.end(), in.begin(), in.end()));
+      v.destroy(a);
+    } else {
+      auto sp = v.as_span(size);
+      REQUIRE(std::equal(sp.begin(), sp.end(), in.begin(), in.end()));
+      v.destroy(a, size);
+    }
+  }
+}
+
+TEST_CASE("size_header_policies", "[dependent_lib]") {
+  using dependent_lib::fixed_size_header;
+  using dependent_lib::hashed_header;
+  using dependent_lib::no_size_header;
+  using dependent_lib::varint_size_header;
+
+  check_size_header<char, varint_size_header>();
+  check_size_header<int16_t, varint_size_header>();
+  check_size_header<int64_t, varint_size_header>();
+  check_size_header<char, fixed_size_header>();
+  check_size_header<int16_t, fixed_size_header>();
+  check_size_header<int64_t, fixed_size_header>();
+  check_size_header<char, hashed_header<uint32_t, varint_size_header>>();
+  check_size_header<char, no_size_header>();
+  check_size_header<char, hashed_header<uint32_t, no_size_header>>();
+  check_size_header<int64_t, hashed_header<uint64_t, no_size_header>>();
+}
+
+TEST_CASE("no_size_header", "[dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<int>>;
+  using vec_t =
+      dependent_lib::vector<int, vec_allocator, dependent_lib::no_size_header>;
+  static_assert(!dependent_lib::DependentType<vec_t, vec_allocator>, "");
+
+  vec_allocator a;
+  vec_t v(std::allocator_arg, a, arr1);
+  auto sp = v.as_span(std::size(arr1));
+  REQUIRE(std::equal(sp.begin(), sp.end(), std::begin(arr1), std::end(arr1)));
+  v.destroy(a, std::size(arr1));
+}
+
+TEST_CASE("hashed_header_required_size", "[dependent_lib]") {
+  using dependent_lib::hashed_header;
+
+  static_assert(hashed_header<>::required_space_in_types<char>(9) == 18, "");
+  static_assert(
+      hashed_header<>::required_space_in_types<char>(256) == 257 + 16 + 8, "");
+  static_assert(hashed_header<>::required_space_in_types<int32_t>(9) == 12,
+                "");
+  static_assert(
+      hashed_header<uint32_t>::required_space_in_types<char>(9) == 14, "");
+  static_assert(
+      hashed_header<uint32_t>::required_space_in_types<int64_t>(9) == 11, "");
+}
+
+TEST_CASE("hashed_header", "[dependent_lib]") {
+  using dependent_lib::hashed_header;
+  using vec_t =
+      dependent_lib::vector<char, std::allocator<char>, hashed_header<>>;
+  using small_hash_vec_t = dependent_lib::vector<char, std::allocator<char>,
+                                                 hashed_header<uint32_t>>;
+
+  std::allocator<char> a;
+  std::string big(300, 'x');
+  vec_t x(std::allocator_arg, a, std::string("abc"));
+  vec_t y(std::allocator_arg, a, std::string("abd"));
+  vec_t z(std::allocator_arg, a, big);
+  small_hash_vec_t w(std::allocator_arg, a, big);
+
+  auto sp = x.as_span();
+  REQUIRE(std::string(sp.begin(), sp.end()) == "abc");
+  REQUIRE(z.as_span().size() == 300);
+  REQUIRE(std::equal(big.begin(), big.end(), w.as_span().begin()));
+
+  REQUIRE(x.cached_hash() ==
+          dependent_lib::detail::hash_span(sp.begin(), sp.end()));
+  REQUIRE(w.cached_hash() == static_cast<uint32_t>(z.cached_hash()));
+  REQUIRE(x.cached_hash() != y.cached_hash());
+
+  REQUIRE(x == x);
+  REQUIRE(x != y);
+  REQUIRE(x < y);
+
+  x.destroy(a);
+  y.destroy(a);
+  z.destroy(a);
+  w.destroy(a);
 }
 
 TEST_CASE("concepts", "[dependent_lib]") {
@@ -67,6 +215,49 @@ TEST_CASE("destroy", "[dependent_lib]") {
   dv.destroy(a);
 }
 
+TEST_CASE("bulk_construction", "[dependent_lib]") {
+  using namespace dependent_lib::detail;
+  using alloc_t = dependent_lib::allocator_adaptor<std::allocator<short>>;
+  using vec_t = dependent_lib::vector<short, alloc_t>;
+
+  static_assert(BulkCopyIteratorImpl<short, alloc_t, short*>::value, "");
+  static_assert(BulkCopyIteratorImpl<short, alloc_t, const short*>::value, "");
+  static_assert(
+      BulkCopyIteratorImpl<short, alloc_t, std::move_iterator<short*>>::value,
+      "");
+  static_assert(!BulkCopyIteratorImpl<short, alloc_t, const int*>::value, "");
+  static_assert(!BulkCopyIteratorImpl<short, alloc_t,
+                                      std::list<short>::iterator>::value,
+                "");
+  static_assert(bulk_copyable_range<short, alloc_t, std::vector<short>&>(), "");
+  static_assert(!bulk_copyable_range<short, alloc_t, std::list<short>&>(), "");
+
+  alloc_t a;
+  std::vector<short> input(1'000, 3);
+  std::list<short> list_input(std::begin(arr1), std::end(arr1));
+  std::vector<int> ints(std::begin(arr1), std::end(arr1));
+
+  vec_t from_array(std::allocator_arg, a, arr1);
+  vec_t from_pointers(std::allocator_arg, a, std::begin(arr1), std::end(arr1));
+  vec_t from_vector(std::allocator_arg, a, input);
+  vec_t from_rvalue(std::allocator_arg, a, std::vector<short>(input));
+  vec_t from_list(std::allocator_arg, a, list_input);
+  vec_t from_ints(std::allocator_arg, a, ints);
+  vec_t from_empty(std::allocator_arg, a, std::vector<short>{});
+
+  REQUIRE(from_array == from_pointers);
+  REQUIRE(from_array == from_list);
+  REQUIRE(from_array == from_ints);
+  REQUIRE(from_vector == from_rvalue);
+  REQUIRE(from_empty.as_span().size() == 0);
+  auto sp = from_vector.as_span();
+  REQUIRE(std::equal(sp.begin(), sp.end(), input.begin(), input.end()));
+
+  for (vec_t* v : {&from_array, &from_pointers, &from_vector, &from_rvalue,
+                   &from_list, &from_ints, &from_empty})
+    v->destroy(a);
+}
+
 TEST_CASE("set_of_vector", "[dependent_lib]") {
   using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<short>>;
   using vec_t = dependent_lib::vector<short, vec_allocator>;
@@ -136,6 +327,338 @@ TEST_CASE("vector_with_dense_allocator", "[dependent_lib]") {
     v.insert(v.end(), std::begin(arr1), std::end(arr1));
 }
 
+TEST_CASE("dense_allocator_tail_expansion", "[dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::dense_allocators<std::allocator<int>, int>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+  dense_allocators resourse(std::allocator<int>{});
+  allocator_handle a(&resourse);
+
+  int* p = a.allocate(10);
+  REQUIRE(dependent_lib::detail::try_expand(a, p, 10, 20));
+  REQUIRE(a.allocate(1) == p + 20);
+
+  // Only the most recent allocation can change.
+  REQUIRE(!a.try_expand(p, 20, 30));
+  a.deallocate(p + 20, 1);
+  REQUIRE(a.try_expand(p, 20, 5));
+  REQUIRE(a.allocate(1) == p + 5);
+
+  // No room left in the block.
+  REQUIRE(!a.try_expand(p + 5, 1, 2000));
+
+  // Allocators without try_expand.
+  std::allocator<int> std_a;
+  REQUIRE(!dependent_lib::detail::try_expand(std_a, p, 1, 2));
+}
+
+TEST_CASE("dense_size_classes", "[dense_allocator]") {
+  using namespace dependent_lib::detail;
+
+  constexpr std::size_t sizes[] = {1,  2,  3,  4,  6,  8,  12,
+                                   16, 24, 32, 48, 64, 96, 128};
+  for (std::size_t c = 0; c != std::size(sizes); ++c) {
+    REQUIRE(size_class_size(c) == sizes[c]);
+    REQUIRE(size_class_of(sizes[c]) == c);
+    if (c) REQUIRE(size_class_of(sizes[c - 1] + 1) == c);
+  }
+  for (std::size_t n = 1; n != 10'000; ++n) {
+    REQUIRE(size_class_size(size_class_of(n)) >= n);
+    REQUIRE(size_class_size(size_class_of(n)) * 2 < n * 3);
+  }
+}
+
+TEST_CASE("dense_allocator_reuses_freed", "[dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::reusing_dense_allocators<std::allocator<char>, char>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<char, dense_allocators>;
+  dense_allocators resourse(std::allocator<char>{});
+  allocator_handle a(&resourse);
+
+  char* x = a.allocate(10);
+  char* y = a.allocate(3);
+  a.deallocate(x, 10);
+  // Same size class (12).
+  REQUIRE(a.allocate(11) == x);
+  // Smaller than a pointer, rounded up to one.
+  a.deallocate(y, 3);
+  REQUIRE(a.allocate(8) == y);
+}
+
+TEST_CASE("dense_allocator_churn", "[dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::reusing_dense_allocators<std::allocator<int>,
+                                              dependent_lib::unknown_type<40, 8>>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+  dense_allocators resourse(std::allocator<int>{});
+
+  std::set<int, std::less<>, allocator_handle> s(allocator_handle{&resourse});
+  for (int i = 0; i < 1000; ++i) s.insert(i);
+
+  std::set<const int*> nodes;
+  for (const int& x : s) nodes.insert(&x);
+
+  // Nodes freed by erase are reused by later inserts.
+  for (int round = 1; round < 10; ++round) {
+    for (int i = 0; i < 1000; i += 2) s.erase(i + (round - 1) * 1000);
+    for (int i = 0; i < 1000; i += 2) s.insert(i + round * 1000);
+    for (int i = 1; i < 1000; i += 2) s.erase(i + (round - 1) * 1000);
+    for (int i = 1; i < 1000; i += 2) s.insert(i + round * 1000);
+  }
+  REQUIRE(s.size() == 1000);
+  for (const int& x : s) REQUIRE(nodes.count(&x) == 1);
+}
+
+struct growing_policy : dependent_lib::default_dense_policy {
+  static constexpr std::size_t block_size = 4096;
+  static constexpr std::size_t block_growth = 2;
+  static constexpr std::size_t max_block_size = 16384;
+};
+
+TEST_CASE("dense_allocator_block_growth", "[dense_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using dense_allocators =
+      dependent_lib::basic_dense_allocators<growing_policy,
+                                            dependent::stats_allocator<char, tag>,
+                                            char>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<char, dense_allocators>;
+
+  {
+    dense_allocators resourse(dependent::stats_allocator<char, tag>{});
+    allocator_handle a(&resourse);
+    // Blocks are taken lazily.
+    REQUIRE(stats::total_allocated_size() == 0);
+
+    // Blocks are pages, the first cache line is the block header.
+    char* p = a.allocate(4000);
+    REQUIRE(reinterpret_cast<uintptr_t>(p) % 4096 == 64);
+    REQUIRE(stats::total_allocated_size() == 4096);
+    REQUIRE(a.allocate(32) == p + 4000);
+
+    p = a.allocate(4000);
+    REQUIRE(reinterpret_cast<uintptr_t>(p) % 4096 == 64);
+    REQUIRE(stats::total_allocated_size() == 4096 + 8192);
+    a.allocate(8000);
+    REQUIRE(stats::total_allocated_size() == 4096 + 8192 + 16384);
+    a.allocate(12000);
+    REQUIRE(stats::total_allocated_size() == 4096 + 8192 + 2 * 16384);
+    // Too big for a block: pages of its own, with a header.
+    a.allocate(20000);
+    REQUIRE(stats::total_allocated_size() ==
+            4096 + 8192 + 2 * 16384 + 5 * 4096);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("dense_allocator_rewind", "[dense_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using dense_allocators = dependent_lib::basic_dense_allocators<
+      growing_policy, dependent::stats_allocator<char, tag>, char, int>;
+  using char_handle =
+      dependent_lib::dense_allocator_handler<char, dense_allocators>;
+  using int_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+
+  {
+    dense_allocators resourse(dependent::stats_allocator<char, tag>{});
+    char_handle c(&resourse);
+    int_handle i(&resourse);
+
+    char* kept = c.allocate(100);
+    const auto cp = resourse.checkpoint();
+
+    auto fill = [&] {
+      std::vector<void*> res;
+      for (int n = 0; n < 20; ++n) {
+        res.push_back(c.allocate(1000));
+        res.push_back(i.allocate(500));
+      }
+      // Too big for a block.
+      res.push_back(c.allocate(20000));
+      return res;
+    };
+
+    const auto first = fill();
+    const auto warmed_up = stats::total_allocated_size();
+
+    resourse.rewind(cp);
+    REQUIRE(stats::total_allocated_size() == warmed_up - 5 * 4096);
+    REQUIRE(c.allocate(1) == kept + 100);
+
+    resourse.rewind(cp);
+    auto second = fill();
+    REQUIRE(stats::total_allocated_size() == warmed_up);
+    second.back() = first.back();
+    REQUIRE(second == first);
+
+    resourse.reset();
+    REQUIRE(c.allocate(100) == kept);
+    REQUIRE(stats::total_allocated_size() == warmed_up - 5 * 4096);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+struct large_caching_policy : dependent_lib::default_dense_policy {
+  static constexpr std::size_t large_cache_size = 1 << 20;
+};
+
+TEST_CASE("dense_allocator_large_allocations", "[dense_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators =
+      dependent_lib::dense_allocators<backing_allocator, char>;
+  using caching_dense_allocators =
+      dependent_lib::basic_dense_allocators<large_caching_policy,
+                                            backing_allocator, char>;
+
+  {
+    dense_allocators resourse(backing_allocator{});
+    dependent_lib::dense_allocator_handler<char, dense_allocators> a(
+        &resourse);
+    char* small = a.allocate(100);
+
+    // A temporary doesn't stay until the arena is destroyed.
+    constexpr std::size_t big = 100 << 20;
+    char* p = a.allocate(big);
+    REQUIRE(reinterpret_cast<uintptr_t>(p) % 4096 == 64);
+    p[big - 1] = 'x';
+    REQUIRE(stats::total_allocated_size() > big);
+    a.deallocate(p, big);
+    REQUIRE(stats::total_allocated_size() == 4096);
+
+    // Grows in its pages.
+    p = a.allocate(10000);
+    REQUIRE(a.try_expand(p, 10000, 12000));
+    REQUIRE(!a.try_expand(p, 12000, 13000));
+    REQUIRE(!a.try_expand(p, 12000, 100));
+    char* q = a.allocate(50000);
+    a.deallocate(p, 12000);
+    a.allocate(30000);
+    REQUIRE(a.allocate(1) == small + 100);
+    a.deallocate(q, 50000);
+    // The rest is released with the arena.
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+
+  {
+    caching_dense_allocators resourse(backing_allocator{});
+    dependent_lib::dense_allocator_handler<char, caching_dense_allocators> a(
+        &resourse);
+    char* p = a.allocate(100'000);
+    const auto used = stats::total_allocated_size();
+    a.deallocate(p, 100'000);
+    REQUIRE(stats::total_allocated_size() == used);
+    REQUIRE(a.allocate(90'000) == p);
+    // Too much bigger than needed.
+    a.deallocate(p, 90'000);
+    REQUIRE(a.allocate(10'000) != p);
+
+    // Over the cache size.
+    char* huge = a.allocate(2 << 20);
+    const auto with_huge = stats::total_allocated_size();
+    a.deallocate(huge, 2 << 20);
+    REQUIRE(stats::total_allocated_size() < with_huge);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("dense_allocator_stats", "[dense_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators = dependent_lib::basic_dense_allocators<
+      dependent_lib::reusing_dense_policy, backing_allocator, char, int64_t>;
+  constexpr std::size_t block_cages = 4096 - 64;
+
+  dense_allocators resourse(backing_allocator{});
+  dependent_lib::dense_allocator_handler<char, dense_allocators> c(&resourse);
+  dependent_lib::dense_allocator_handler<int64_t, dense_allocators> i(
+      &resourse);
+  REQUIRE(resourse.total_stats().blocks == 0);
+
+  char* x = c.allocate(1024);
+  c.allocate(2048);
+  c.allocate(768);
+  // Leaves 192 bytes at the end of the first block.
+  c.allocate(256);
+  c.deallocate(x, 1024);
+  i.allocate(10);
+  c.allocate(10'000);
+
+  const auto [char_stats, int_stats] = resourse.stats();
+  REQUIRE(char_stats.blocks == 2);
+  REQUIRE(char_stats.block_bytes == 2 * 4096);
+  REQUIRE(char_stats.tail_waste_bytes == block_cages - 3840);
+  REQUIRE(char_stats.free_list_bytes == 1024);
+  REQUIRE(char_stats.used_bytes == 3840 + 256 - 1024);
+  REQUIRE(char_stats.large_allocations == 1);
+  REQUIRE(char_stats.large_bytes == 3 * 4096);
+  REQUIRE(int_stats.blocks == 1);
+  REQUIRE(int_stats.used_bytes == 12 * sizeof(int64_t));
+
+  const auto total = resourse.total_stats();
+  REQUIRE(total.block_bytes + total.large_bytes ==
+          stats::total_allocated_size());
+
+  // The arena and the area it takes memory from in one dump.
+  std::ostringstream os;
+  dependent::write_stats(os, "area", stats{});
+  dependent::write_stats(os, "arena", total);
+  REQUIRE(os.str().find("arena.dense_used 3168\n") != std::string::npos);
+  REQUIRE(os.str().find("area.") != std::string::npos);
+
+  // Rewinding forgets the waste of the blocks after the checkpoint.
+  resourse.reset();
+  REQUIRE(resourse.total_stats().used_bytes == 0);
+  REQUIRE(resourse.total_stats().tail_waste_bytes == 0);
+  REQUIRE(resourse.total_stats().blocks == 3);
+}
+
+TEST_CASE("dense_allocator_big_elements", "[dense_allocator]") {
+  using big = dependent_lib::unknown_type<5000, 8>;
+  using dense_allocators =
+      dependent_lib::dense_allocators<std::allocator<big>, big>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<big, dense_allocators>;
+  dense_allocators resourse(std::allocator<big>{});
+  allocator_handle a(&resourse);
+
+  big* x = a.allocate(1);
+  big* y = a.allocate(1);
+  REQUIRE(x != y);
+  std::memset(static_cast<void*>(x), 1, sizeof(big));
+  std::memset(static_cast<void*>(y), 2, sizeof(big));
+}
+
+TEST_CASE("growable_vector_with_dense_allocator", "[dense_allocator]") {
+  using dense_allocators =
+      dependent_lib::dense_allocators<std::allocator<int>, int>;
+  using allocator_handle =
+      dependent_lib::dense_allocator_handler<int, dense_allocators>;
+  using vec_t = dependent_lib::growable_vector<int, allocator_handle>;
+  dense_allocators resourse(std::allocator<int>{});
+  allocator_handle a(&resourse);
+
+  vec_t v;
+  v.push_back(a, 0);
+  const int* first = v.data();
+  // Grows at the tail of the block instead of leaving old buffers behind.
+  for (int i = 1; i < 500; ++i) v.push_back(a, i);
+  REQUIRE(v.data() == first);
+  for (int i = 0; i < 500; ++i) REQUIRE(v[i] == i);
+
+  v.shrink_to_fit(a);
+  REQUIRE(v.capacity() == 500);
+  REQUIRE(a.allocate(1) == v.data() + 500);
+}
+
 TEST_CASE("vector_of_densly_allocated_strings",
           "[dependent_lib, dense_allocator]") {
   using dense_allocators =
@@ -0,0 +1,163 @@
+#include "dependent/flat_hash_set.h"
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
+
+#include <string>
+#include <string_view>
+
+#include "catch/catch.h"
+
+namespace {
+
+struct bytes_hash {
+  template <typename V>
+  std::size_t operator()(const V& v) const {
+    auto sp = v.as_span();
+    return std::hash<std::string_view>{}(
+        {reinterpret_cast<const char*>(sp.begin()),
+         sp.size() * sizeof(*sp.begin())});
+  }
+};
+
+// Puts every key into the same probe sequence.
+struct colliding_hash {
+  std::size_t operator()(int) const { return 42; }
+};
+
+// Counts live instances.
+struct counted {
+  static inline int live = 0;
+  int value;
+
+  counted(int v) : value(v) { ++live; }
+  counted(counted&& x) noexcept : value(x.value) { ++live; }
+  counted(const counted& x) : value(x.value) { ++live; }
+  ~counted() { --live; }
+
+  friend bool operator==(const counted& x, const counted& y) {
+    return x.value == y.value;
+  }
+};
+
+struct counted_hash {
+  std::size_t operator()(const counted& x) const {
+    return std::hash<int>{}(x.value);
+  }
+};
+
+TEST_CASE("flat_hash_set_ints", "[flat_hash_set]") {
+  dependent_lib::flat_hash_set<int> s;
+  REQUIRE(s.empty());
+  REQUIRE(s.find(1) == s.end());
+
+  for (int i = 0; i < 1000; ++i) REQUIRE(s.emplace(i).second);
+  for (int i = 0; i < 1000; ++i) REQUIRE(!s.emplace(i).second);
+
+  REQUIRE(s.size() == 1000);
+  REQUIRE(s.load_factor() <= 0.875f);
+  for (int i = 0; i < 1000; ++i) REQUIRE(*s.find(i) == i);
+  REQUIRE(!s.contains(1000));
+
+  int sum = 0;
+  for (int x : s) sum += x;
+  REQUIRE(sum == 999 * 1000 / 2);
+
+  for (int i = 0; i < 1000; i += 2) REQUIRE(s.erase(i) == 1);
+  REQUIRE(s.erase(0) == 0);
+  REQUIRE(s.size() == 500);
+  for (int i = 0; i < 1000; ++i) REQUIRE(s.contains(i) == (i % 2 == 1));
+
+  s.clear();
+  REQUIRE(s.empty());
+  REQUIRE(s.begin() == s.end());
+}
+
+TEST_CASE("flat_hash_set_destroys_once", "[flat_hash_set]") {
+  {
+    dependent_lib::flat_hash_set<counted, counted_hash> s;
+    for (int i = 0; i < 3; ++i) {
+      counted k(i);
+      REQUIRE(s.insert(std::move(k)).second);
+    }
+    REQUIRE(counted::live == 3);
+    counted k(0);
+    REQUIRE(!s.insert(std::move(k)).second);
+    REQUIRE(counted::live == 4);
+
+    // Through rehashes and the temporary of emplace.
+    for (int i = 3; i < 100; ++i) REQUIRE(s.emplace(i).second);
+    REQUIRE(!s.emplace(5).second);
+    REQUIRE(counted::live == 101);
+    REQUIRE(s.erase(counted(7)) == 1);
+    REQUIRE(counted::live == 100);
+  }
+  REQUIRE(counted::live == 0);
+}
+
+TEST_CASE("flat_hash_set_collisions", "[flat_hash_set]") {
+  dependent_lib::flat_hash_set<int, colliding_hash> s;
+  for (int i = 0; i < 100; ++i) s.emplace(i);
+  for (int i = 0; i < 100; i += 3) s.erase(i);
+  // Reuses tombstones and rehashes in place.
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 100; i += 3) s.emplace(i);
+    for (int i = 0; i < 100; i += 3) s.erase(i);
+  }
+  for (int i = 0; i < 100; ++i) REQUIRE(s.contains(i) == (i % 3 != 0));
+}
+
+TEST_CASE("flat_hash_set_of_vectors", "[flat_hash_set, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using vec_t = dependent_lib::vector<char, vec_allocator>;
+  using set_allocator = dependent_lib::allocator_adaptor<std::allocator<vec_t>>;
+  using set_t = dependent_lib::flat_hash_set<vec_t, bytes_hash,
+                                             std::equal_to<>, set_allocator>;
+  static_assert(sizeof(vec_t) == 8, "");
+
+  set_t s;
+  for (int i = 0; i < 300; ++i) {
+    REQUIRE(s.emplace(std::to_string(i)).second);
+    REQUIRE(!s.emplace(std::to_string(i)).second);
+  }
+  REQUIRE(s.size() == 300);
+
+  vec_allocator a;
+  vec_t key(std::allocator_arg, a, std::string("123"));
+  REQUIRE(s.contains(key));
+  REQUIRE(s.erase(key) == 1);
+  REQUIRE(!s.contains(key));
+  key.destroy(a);
+
+  set_t moved = std::move(s);
+  REQUIRE(s.empty());
+  REQUIRE(moved.size() == 299);
+}
+
+TEST_CASE("flat_hash_set_dense_allocator", "[flat_hash_set, dense_allocator]") {
+  using backing_allocator = std::allocator<void>;
+  using dense_allocators =
+      dependent_lib::dense_allocators<backing_allocator, char,
+                                      dependent_lib::unknown_type<8, 8>>;
+
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using set_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<vec_t, dense_allocators>>;
+  using set_t = dependent_lib::flat_hash_set<vec_t, bytes_hash,
+                                             std::equal_to<>, set_handle>;
+
+  dense_allocators allocs(backing_allocator{});
+  set_t s(set_handle{&allocs});
+  for (int i = 0; i < 1000; ++i) s.emplace(std::to_string(i));
+  REQUIRE(s.size() == 1000);
+
+  std::size_t found = 0;
+  for (const vec_t& v : s) {
+    auto sp = v.as_span();
+    found += s.contains(v) && sp.size() > 0;
+  }
+  REQUIRE(found == 1000);
+}
+
+}  // namespace
@@ -0,0 +1,154 @@
+#include "dependent/growable_vector.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/transparent.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+constexpr short arr1[] = {1, 2, 6, 2, 6};
+
+// Counts allocations on top of std::allocator.
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+  static inline std::size_t allocations = 0;
+
+  template <typename U>
+  struct rebind {
+    using other = counting_allocator<U>;
+  };
+
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    ++allocations;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+TEST_CASE("growable_vector_concepts", "[growable_vector, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<int>>;
+  using vec_t = dependent_lib::growable_vector<int, vec_allocator>;
+  static_assert(sizeof(vec_t) == sizeof(void*), "");
+  static_assert(std::is_trivially_copyable<vec_t>::value, "");
+  static_assert(dependent_lib::DependentType<vec_t, vec_allocator>, "");
+  static_assert(std::uses_allocator<vec_t, vec_allocator>::value, "");
+
+  vec_t empty;
+  REQUIRE(empty.size() == 0);
+  REQUIRE(empty.capacity() == 0);
+  REQUIRE(empty.as_span().size() == 0);
+  empty.destroy(vec_allocator{});
+}
+
+TEST_CASE("growable_vector_push_back", "[growable_vector, dependent_lib]") {
+  using alloc_t = counting_allocator<int>;
+  using vec_t = dependent_lib::growable_vector<int, alloc_t>;
+  alloc_t a;
+
+  vec_t v;
+  alloc_t::allocations = 0;
+  for (int i = 0; i < 100'000; ++i) v.push_back(a, i);
+
+  REQUIRE(v.size() == 100'000);
+  REQUIRE(v.capacity() >= v.size());
+  // Geometric growth.
+  REQUIRE(alloc_t::allocations <= 20);
+  for (int i = 0; i < 100'000; ++i) REQUIRE(v[i] == i);
+
+  // Pushing an element of the vector itself while it reallocates.
+  v.shrink_to_fit(a);
+  REQUIRE(v.size() == v.capacity());
+  v.push_back(a, v[0]);
+  v.push_back(a, v[3]);
+  REQUIRE(v.back() == 3);
+  REQUIRE(v[100'000] == 0);
+
+  v.destroy(a);
+}
+
+TEST_CASE("growable_vector_resize_insert", "[growable_vector, dependent_lib]") {
+  using vec_t = dependent_lib::growable_vector<short, std::allocator<short>>;
+  std::allocator<short> a;
+
+  vec_t v(std::allocator_arg, a, arr1);
+  REQUIRE(v.as_span().size() == 5);
+
+  std::vector<short> expected(std::begin(arr1), std::end(arr1));
+  v.resize(a, 8);
+  expected.resize(8);
+  REQUIRE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+  v.insert(a, v.begin() + 2, arr1);
+  expected.insert(expected.begin() + 2, std::begin(arr1), std::end(arr1));
+  REQUIRE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+  std::vector<short> tail = {9, 9};
+  v.insert(a, v.end(), tail.begin(), tail.end());
+  expected.insert(expected.end(), tail.begin(), tail.end());
+  REQUIRE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+  v.reserve(a, 1000);
+  REQUIRE(v.capacity() == 1000);
+  REQUIRE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+  v.resize(a, 3);
+  v.pop_back(a);
+  expected.resize(2);
+  REQUIRE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+  vec_t same(std::allocator_arg, a, expected);
+  REQUIRE(v == same);
+  REQUIRE(std::hash<vec_t>{}(v) == dependent_lib::span_hash{}(expected));
+
+  v.clear(a);
+  REQUIRE(v.empty());
+  v.destroy(a);
+  same.destroy(a);
+}
+
+TEST_CASE("growable_vector_of_dependent_vectors",
+          "[growable_vector, dependent_lib]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using inner_allocator = dependent_lib::allocator_adaptor<
+      dependent::stats_allocator<char, tag>>;
+  using inner_t = dependent_lib::vector<char, inner_allocator>;
+  using outer_allocator = dependent_lib::allocator_adaptor<
+      dependent::stats_allocator<inner_t, tag>>;
+  using outer_t = dependent_lib::growable_vector<inner_t, outer_allocator>;
+
+  {
+    outer_allocator a;
+    outer_t v;
+    for (int i = 0; i < 1000; ++i) v.emplace_back(a, std::to_string(i));
+    REQUIRE(v.size() == 1000);
+    auto sp = v[999].as_span();
+    REQUIRE(std::string(sp.begin(), sp.end()) == "999");
+
+    v.pop_back(a);
+    v.destroy(a);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("map_of_growable_vectors", "[growable_vector, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<int>>;
+  using vec_t = dependent_lib::growable_vector<int, vec_allocator>;
+  using map_allocator = dependent_lib::allocator_adaptor<
+      std::allocator<std::pair<const int, vec_t>>>;
+
+  std::map<int, vec_t, std::less<>, map_allocator> mp;
+  auto& v = mp.emplace(3, arr1).first->second;
+  v.push_back(vec_allocator{}, 7);
+  REQUIRE(v.size() == 6);
+}
+
+}  // namespace
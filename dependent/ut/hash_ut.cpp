@@ -0,0 +1,135 @@
+#include "dependent/hash.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/dependent.h"
+#include "dependent/flat_hash_set.h"
+#include "dependent/transparent.h"
+
+namespace {
+
+TEST_CASE("hash_bytes_distinct", "[hash]") {
+  std::unordered_set<std::size_t> seen;
+  std::string s;
+  for (int len = 0; len < 200; ++len) {
+    REQUIRE(seen.insert(dependent_lib::detail::hash_bytes(s.data(), len))
+                .second);
+    s.push_back(static_cast<char>('a' + len % 26));
+  }
+
+  // Every bit of every stripe and tail matters.
+  std::string input(100, 'x');
+  auto base = dependent_lib::detail::hash_bytes(input.data(), input.size());
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    for (int bit = 0; bit < 8; ++bit) {
+      auto flipped = input;
+      flipped[i] ^= static_cast<char>(1 << bit);
+      REQUIRE(dependent_lib::detail::hash_bytes(flipped.data(),
+                                                flipped.size()) != base);
+    }
+  }
+
+  REQUIRE(dependent_lib::detail::hash_bytes(input.data(), input.size(), 1) !=
+          base);
+}
+
+TEST_CASE("hash_identical_for_identical_content", "[hash]") {
+  using vec_t = dependent_lib::vector<char, std::allocator<char>>;
+  using leaky_t = dependent_lib::leaky_vector<char, std::allocator<char>>;
+  using hashed_vec_t = dependent_lib::vector<char, std::allocator<char>,
+                                             dependent_lib::hashed_header<>>;
+
+  std::allocator<char> a;
+  for (std::string s : {std::string(), std::string("a"), std::string("abc"),
+                        std::string("abcdefgh"),
+                        std::string("a longer key to hash"),
+                        std::string(300, 'z')}) {
+    vec_t v(std::allocator_arg, a, s);
+    hashed_vec_t hv(std::allocator_arg, a, s);
+    const leaky_t& lv = v;
+
+    char* f = s.data();
+    future_std_stubs::span<const char> sp{f, f + s.size()};
+    future_std_stubs::string_view sv{f, f + s.size()};
+
+    auto h = std::hash<vec_t>{}(v);
+    REQUIRE(h == std::hash<leaky_t>{}(lv));
+    REQUIRE(h == std::hash<hashed_vec_t>{}(hv));
+    REQUIRE(h == std::hash<future_std_stubs::span<const char>>{}(sp));
+    REQUIRE(h == std::hash<future_std_stubs::string_view>{}(sv));
+    REQUIRE(h == dependent_lib::span_hash{}(std::string_view(s)));
+    REQUIRE(h == hv.cached_hash());
+
+    v.destroy(a);
+    hv.destroy(a);
+  }
+}
+
+TEST_CASE("hash_nested_vectors_by_content", "[hash, dependent_lib]") {
+  using inner_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using inner_t = dependent_lib::vector<char, inner_allocator>;
+  using outer_allocator =
+      dependent_lib::allocator_adaptor<std::allocator<inner_t>>;
+  using outer_t = dependent_lib::vector<inner_t, outer_allocator>;
+  using hashed_outer_t = dependent_lib::vector<inner_t, outer_allocator,
+                                               dependent_lib::hashed_header<>>;
+  static_assert(!dependent_lib::detail::bitwise_hashable<inner_t>, "");
+
+  const std::vector<std::string> words = {"a", "nested", "key"};
+  outer_allocator a;
+  // Same contents, different payloads.
+  outer_t x(std::allocator_arg, a, words);
+  outer_t y(std::allocator_arg, a, words);
+  hashed_outer_t hx(std::allocator_arg, a, words);
+  hashed_outer_t hy(std::allocator_arg, a, words);
+
+  REQUIRE(x == y);
+  REQUIRE(std::hash<outer_t>{}(x) == std::hash<outer_t>{}(y));
+  REQUIRE(dependent_lib::span_hash{}(x) == dependent_lib::span_hash{}(y));
+  REQUIRE(hx.cached_hash() == hy.cached_hash());
+  REQUIRE(hx == hy);
+  REQUIRE(hx.cached_hash() == std::hash<outer_t>{}(x));
+
+  using set_allocator =
+      dependent_lib::allocator_adaptor<std::allocator<outer_t>>;
+  dependent_lib::flat_hash_set<outer_t, std::hash<outer_t>, std::equal_to<>,
+                               set_allocator>
+      fs;
+  REQUIRE(fs.emplace(words).second);
+  REQUIRE(!fs.emplace(words).second);
+  REQUIRE(fs.contains(x));
+
+  x.destroy(a);
+  y.destroy(a);
+  hx.destroy(a);
+  hy.destroy(a);
+}
+
+TEST_CASE("std_hash_in_containers", "[hash, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<short>>;
+  using vec_t = dependent_lib::vector<short, vec_allocator>;
+  using set_allocator = dependent_lib::allocator_adaptor<std::allocator<vec_t>>;
+
+  std::vector<short> key = {1, 2, 3};
+
+  std::unordered_set<vec_t, std::hash<vec_t>, std::equal_to<>, set_allocator>
+      s;
+  s.emplace(key);
+  s.emplace(key);
+  REQUIRE(s.size() == 1);
+
+  dependent_lib::flat_hash_set<vec_t, std::hash<vec_t>, std::equal_to<>,
+                               set_allocator>
+      fs;
+  fs.emplace(key);
+  key.push_back(4);
+  fs.emplace(key);
+  REQUIRE(fs.size() == 2);
+}
+
+}  // namespace
@@ -0,0 +1,73 @@
+#include "dependent/huge_page_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "catch/catch.h"
+
+#include "dependent/dense_allocator.h"
+#include "dependent/dependent.h"
+
+namespace {
+
+constexpr std::size_t huge_page = dependent_lib::huge_page_pool::huge_page_size;
+
+TEST_CASE("huge_page_pool", "[huge_page_allocator]") {
+  for (auto prefered :
+       {dependent_lib::huge_page_mode::hugetlb,
+        dependent_lib::huge_page_mode::transparent,
+        dependent_lib::huge_page_mode::normal}) {
+    dependent_lib::huge_page_pool pool(1, prefered);
+    REQUIRE(pool.mapped_size() == 0);
+
+    auto* x = static_cast<char*>(pool.allocate(100, 1));
+    auto* y = static_cast<char*>(pool.allocate(100, 64));
+    REQUIRE(pool.mapped_size() == huge_page);
+    // Never better than asked for.
+    REQUIRE(pool.mode() <= prefered);
+    if (pool.mode() == dependent_lib::huge_page_mode::transparent)
+      REQUIRE(dependent_lib::huge_page_pool::transparent_huge_pages_enabled());
+
+    REQUIRE(reinterpret_cast<uintptr_t>(y) % 64 == 0);
+    REQUIRE(y >= x + 100);
+    std::fill(x, x + 100, 'x');
+    std::fill(y, y + 100, 'y');
+
+    // Big requests are mapped on their own and unmapped on deallocate.
+    constexpr std::size_t big = 3 << 20;
+    auto* z = static_cast<char*>(pool.allocate(big, 8));
+    z[big - 1] = 'z';
+    pool.deallocate(z, big);
+    REQUIRE(pool.mapped_size() == huge_page);
+  }
+}
+
+TEST_CASE("dense_allocators_on_huge_pages",
+          "[huge_page_allocator, dense_allocator]") {
+  using backing_allocator = dependent_lib::huge_page_allocator<char>;
+  using dense_allocators = dependent_lib::basic_dense_allocators<
+      dependent_lib::growing_dense_policy, backing_allocator, char,
+      dependent_lib::unknown_type<48, 8>>;
+
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::dense_allocator_handler<char, dense_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using map_handle =
+      dependent_lib::allocator_adaptor<dependent_lib::dense_allocator_handler<
+          std::pair<const vec_t, vec_t>, dense_allocators>>;
+  using map_t = std::map<vec_t, vec_t, std::less<>, map_handle>;
+
+  dependent_lib::huge_page_pool pool;
+  {
+    dense_allocators allocs(backing_allocator{&pool});
+    map_t container(&allocs);
+    for (int i = 0; i < 10'000; ++i)
+      container.emplace(std::to_string(i), std::string(i % 100, 'v'));
+    REQUIRE(container.size() == 10'000);
+  }
+  REQUIRE(pool.mapped_size() == 64 * huge_page);
+}
+
+}  // namespace
@@ -0,0 +1,157 @@
+#include "dependent/memory_resource.h"
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/dependent.h"
+#include "dependent/transparent.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+std::string as_string(dependent_lib::span<const char> sp) {
+  return std::string(sp.begin(), sp.end());
+}
+
+// Counts what reaches it.
+struct counting_resource : std::pmr::memory_resource {
+  std::size_t allocations = 0;
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    --allocations;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST_CASE("dense_memory_resource_dispatch", "[memory_resource]") {
+  using dense_allocators =
+      dependent_lib::dense_allocators<std::allocator<char>, char, int64_t,
+                                      dependent_lib::unknown_type<48, 8>>;
+  using resource_t = dependent_lib::dense_memory_resource<dense_allocators>;
+
+  static_assert(resource_t::select(3, 1) == 0, "");
+  static_assert(resource_t::select(16, 8) == 1, "");
+  static_assert(resource_t::select(96, 8) == 1, "");
+  static_assert(resource_t::select(44, 4) == 1, "");
+  static_assert(resource_t::select(8, 16) == 3, "");
+
+  dense_allocators allocs(std::allocator<char>{});
+  counting_resource upstream;
+  resource_t resource(&allocs, &upstream);
+
+  for (int i = 0; i < 700; ++i) {
+    REQUIRE(resource.allocate(i % 5 + 1, 1) != nullptr);
+    auto* p = resource.allocate(i % 7 * 8 + 8, 8);
+    REQUIRE(reinterpret_cast<uintptr_t>(p) % 8 == 0);
+  }
+  const auto stats = allocs.stats();
+  REQUIRE(stats[0].used_bytes == 2100);
+  REQUIRE(stats[1].used_bytes == 22400);
+  REQUIRE(stats[2].used_bytes == 0);
+  REQUIRE(upstream.allocations == 0);
+
+  // The most recent allocation is given back.
+  void* p = resource.allocate(24, 8);
+  resource.deallocate(p, 24, 8);
+  REQUIRE(resource.allocate(24, 8) == p);
+
+  void* q = resource.allocate(32, 32);
+  REQUIRE(upstream.allocations == 1);
+  resource.deallocate(q, 32, 32);
+  REQUIRE(upstream.allocations == 0);
+
+  REQUIRE(resource.is_equal(resource));
+  resource_t other(&allocs);
+  REQUIRE(!resource.is_equal(other));
+}
+
+TEST_CASE("pmr_and_dependent_containers_share_arena", "[memory_resource]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using dense_allocators = dependent_lib::dense_allocators<
+      backing_allocator, char, int, dependent_lib::unknown_type<48, 8>>;
+  using vec_t = dependent_lib::pmr::vector<char>;
+  using map_t = std::map<vec_t, vec_t, dependent_lib::span_less,
+                         dependent_lib::pmr::allocator<
+                             std::pair<const vec_t, vec_t>>>;
+
+  {
+    dense_allocators allocs(backing_allocator{});
+    dependent_lib::dense_memory_resource<dense_allocators> resource(&allocs);
+
+    map_t m(&resource);
+    std::pmr::vector<int> ints(&resource);
+    for (int i = 0; i < 1000; ++i) {
+      m.emplace(std::to_string(i), std::string(i % 20, 'v'));
+      ints.push_back(i);
+    }
+    REQUIRE(stats::total_allocated_size() > 0);
+    const auto all = allocs.stats();
+    REQUIRE(all[0].used_bytes > 0);
+    REQUIRE(all[1].used_bytes > 0);
+    REQUIRE(all[2].used_bytes == 1000 * 48);
+
+    for (int i = 0; i < 1000; ++i) {
+      auto it = m.find(std::to_string(i));
+      REQUIRE(it != m.end());
+      REQUIRE(as_string(it->second.as_span()) == std::string(i % 20, 'v'));
+      REQUIRE(ints[i] == i);
+    }
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("slab_memory_resource", "[memory_resource]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using slab_allocators =
+      dependent_lib::reusing_slab_allocators<backing_allocator>;
+  using vec_t = dependent_lib::pmr::vector<char>;
+
+  {
+    slab_allocators slabs(backing_allocator{});
+    counting_resource upstream;
+    dependent_lib::slab_memory_resource<slab_allocators> resource(&slabs,
+                                                                  &upstream);
+
+    std::pmr::map<int, std::pmr::string> m(&resource);
+    std::pmr::vector<vec_t> v(&resource);
+    for (int i = 0; i < 1000; ++i) {
+      m.emplace(i, std::string(i % 50, 's'));
+      v.emplace_back(std::to_string(i));
+    }
+    for (int i = 0; i < 1000; i += 2) m.erase(i);
+    REQUIRE(slabs.total_stats().free_list_bytes > 0);
+    REQUIRE(std::string(m.at(999)) == std::string(999 % 50, 's'));
+    REQUIRE(as_string(v[999].as_span()) == "999");
+    REQUIRE(upstream.allocations == 0);
+
+    struct alignas(128) wide {
+      char x[128];
+    };
+    std::pmr::polymorphic_allocator<wide> a(&resource);
+    a.deallocate(a.allocate(1), 1);
+    REQUIRE(upstream.allocations == 0);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+}  // namespace
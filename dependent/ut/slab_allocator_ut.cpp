@@ -0,0 +1,177 @@
+#include "dependent/slab_allocator.h"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/dependent.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+TEST_CASE("slab_size_classes", "[slab_allocator]") {
+  using namespace dependent_lib::detail;
+
+  static_assert(slab_class_size(slab_class_of(1)) == 8, "");
+  static_assert(slab_class_size(slab_class_of(24)) == 24, "");
+  static_assert(slab_class_size(slab_class_of(65)) == 80, "");
+  static_assert(slab_class_size(slab_class_of(129)) == 160, "");
+  static_assert(slab_class_size(slab_class_of(1000)) == 1024, "");
+
+  for (std::size_t c = 0; c < 40; ++c) {
+    REQUIRE(slab_class_of(slab_class_size(c)) == c);
+    REQUIRE(slab_class_of(slab_class_size(c) + 1) == c + 1);
+    REQUIRE(slab_class_size(c) % 8 == 0);
+  }
+  // Less than a quarter is wasted past the first classes.
+  for (std::size_t n = 64; n < 100'000; ++n)
+    REQUIRE(slab_class_size(slab_class_of(n)) * 4 < n * 5 + 4);
+}
+
+TEST_CASE("slab_allocator_alignment", "[slab_allocator]") {
+  struct alignas(16) a16 {
+    char x[40];
+  };
+  struct alignas(64) a64 {
+    char x[72];
+  };
+  using slab_allocators = dependent_lib::slab_allocators<std::allocator<char>>;
+  slab_allocators slabs(std::allocator<char>{});
+
+  dependent_lib::slab_allocator_handler<a16, slab_allocators> h16(&slabs);
+  dependent_lib::slab_allocator_handler<a64, slab_allocators> h64(&slabs);
+  dependent_lib::slab_allocator_handler<char, slab_allocators> hc(&slabs);
+  for (int i = 0; i < 1000; ++i) {
+    hc.allocate(i % 13 + 1);
+    REQUIRE(reinterpret_cast<uintptr_t>(h16.allocate(1)) % 16 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(h64.allocate(1)) % 64 == 0);
+    // Too big for a class.
+    REQUIRE(reinterpret_cast<uintptr_t>(h16.allocate(100)) % 16 == 0);
+  }
+}
+
+TEST_CASE("std_containers_on_slab_allocator", "[slab_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using slab_allocators =
+      dependent_lib::reusing_slab_allocators<backing_allocator>;
+  using map_t =
+      std::map<int, std::string, std::less<>,
+               dependent_lib::slab_allocator_handler<
+                   std::pair<const int, std::string>, slab_allocators>>;
+  using list_t = std::list<
+      double, dependent_lib::slab_allocator_handler<double, slab_allocators>>;
+  using unordered_t = std::unordered_map<
+      int, int, std::hash<int>, std::equal_to<>,
+      dependent_lib::slab_allocator_handler<std::pair<const int, int>,
+                                            slab_allocators>>;
+
+  {
+    slab_allocators slabs(backing_allocator{});
+    REQUIRE(stats::total_allocated_size() == 0);
+    REQUIRE(slabs.used_classes() == 0);
+
+    map_t m(map_t::allocator_type{&slabs});
+    list_t l(list_t::allocator_type{&slabs});
+    unordered_t u(unordered_t::allocator_type{&slabs});
+    for (int i = 0; i < 10'000; ++i) {
+      m.emplace(i, std::to_string(i));
+      l.push_back(i);
+      u.emplace(i, i);
+    }
+    REQUIRE(m.size() == 10'000);
+    REQUIRE(u.at(5000) == 5000);
+    REQUIRE(l.back() == 9999);
+    // Classes are created on demand: the nodes and the first few bucket
+    // arrays.
+    REQUIRE(slabs.used_classes() <= 8);
+    REQUIRE(slabs.used_classes() < slabs.class_count);
+
+    // Freed nodes are reused.
+    const auto used = stats::total_allocated_size();
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 10'000; ++i) {
+        m.erase(i);
+        m.emplace(i, "x");
+        l.pop_front();
+        l.push_back(i);
+      }
+    }
+    REQUIRE(stats::total_allocated_size() == used);
+
+    const auto total = slabs.total_stats();
+    REQUIRE(total.block_bytes + total.large_bytes == used);
+    REQUIRE(total.free_list_bytes == 0);
+    l.pop_front();
+    l.pop_front();
+    REQUIRE(slabs.total_stats().free_list_bytes == 2 * 24);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+TEST_CASE("dependent_vectors_on_slab_allocator", "[slab_allocator]") {
+  using slab_allocators = dependent_lib::slab_allocators<std::allocator<char>>;
+  using vec_t_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::slab_allocator_handler<char, slab_allocators>>;
+  using vec_t = dependent_lib::vector<char, vec_t_handle>;
+  using set_handle = dependent_lib::allocator_adaptor<
+      dependent_lib::slab_allocator_handler<vec_t, slab_allocators>>;
+  using set_t = std::set<vec_t, std::less<>, set_handle>;
+
+  slab_allocators slabs(std::allocator<char>{});
+  set_t container(&slabs);
+  for (int i = 0; i < 1000; ++i) container.emplace(std::string(i, 'v'));
+  REQUIRE(container.size() == 1000);
+  REQUIRE(container.rbegin()->as_span().size() == 999);
+
+  // Grows in place while it stays in its class.
+  dependent_lib::slab_allocator_handler<int, slab_allocators> a(&slabs);
+  int* p = a.allocate(5);
+  REQUIRE(a.try_expand(p, 5, 6));
+  REQUIRE(!a.try_expand(p, 6, 7));
+  a.deallocate(p, 6);
+}
+
+TEST_CASE("slab_allocator_large_churn", "[slab_allocator]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using backing_allocator = dependent::stats_allocator<char, tag>;
+  using slab_allocators =
+      dependent_lib::reusing_slab_allocators<backing_allocator>;
+
+  {
+    slab_allocators slabs(backing_allocator{});
+    // Too big for a class. The biggest don't fit in a block of the large
+    // arena and get pages of their own.
+    auto size_of = [](int i) -> std::size_t { return 1024 + i % 5 * 768; };
+    std::vector<void*> buffers;
+    for (int i = 0; i < 200; ++i)
+      buffers.push_back(slabs.allocate(size_of(i), 8));
+
+    // Buffers freed in the middle of the arena are reused by later
+    // allocations of their size.
+    std::size_t allocated = 0;
+    for (int round = 0; round < 10; ++round) {
+      for (int parity = 0; parity < 2; ++parity) {
+        for (int i = parity; i < 200; i += 2)
+          slabs.deallocate(buffers[i], size_of(i), 8);
+        REQUIRE(slabs.total_stats().free_list_bytes > 0);
+        for (int i = parity; i < 200; i += 2)
+          buffers[i] = slabs.allocate(size_of(i), 8);
+      }
+      if (round == 0) allocated = stats::total_allocated_size();
+      REQUIRE(stats::total_allocated_size() == allocated);
+    }
+    for (int i = 0; i < 200; ++i) slabs.deallocate(buffers[i], size_of(i), 8);
+  }
+  REQUIRE(stats::total_allocated_size() == 0);
+}
+
+}  // namespace
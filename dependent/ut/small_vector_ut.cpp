@@ -0,0 +1,100 @@
+#include "dependent/small_vector.h"
+
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/transparent.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+TEST_CASE("small_vector_concepts", "[small_vector, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using vec_t = dependent_lib::small_vector<char, vec_allocator>;
+  static_assert(sizeof(vec_t) == sizeof(void*), "");
+  static_assert(std::is_trivially_copyable<vec_t>::value, "");
+  static_assert(dependent_lib::DependentType<vec_t, vec_allocator>, "");
+  static_assert(std::uses_allocator<vec_t, vec_allocator>::value, "");
+
+  static_assert(vec_t::inline_capacity == 7, "");
+  static_assert(
+      dependent_lib::small_vector<short, std::allocator<short>>::inline_capacity ==
+          3,
+      "");
+  static_assert(
+      dependent_lib::small_vector<int, std::allocator<int>>::inline_capacity ==
+          1,
+      "");
+}
+
+TEST_CASE("small_vector_modes", "[small_vector, dependent_lib]") {
+  using vec_t = dependent_lib::small_vector<char, std::allocator<char>>;
+  std::allocator<char> a;
+
+  for (std::size_t n = 0; n != 20; ++n) {
+    std::string s(n, 'a');
+    for (std::size_t i = 0; i != n; ++i) s[i] += i;
+
+    vec_t v(std::allocator_arg, a, s);
+    REQUIRE(v.is_inline() == (n <= vec_t::inline_capacity));
+    REQUIRE(v.size() == n);
+    auto sp = v.as_span();
+    REQUIRE(std::string_view(sp.begin(), sp.size()) == s);
+
+    vec_t copy = v;
+    REQUIRE(copy == v);
+    REQUIRE(std::hash<vec_t>{}(copy) ==
+            dependent_lib::span_hash{}(std::string_view(s)));
+    v.destroy(a);
+  }
+}
+
+TEST_CASE("small_vector_comparison", "[small_vector, dependent_lib]") {
+  using vec_t = dependent_lib::small_vector<short, std::allocator<short>>;
+  std::allocator<short> a;
+
+  std::vector<std::vector<short>> inputs = {
+      {}, {1}, {1, 2}, {1, 2, 3}, {1, 2, 3, 4}, {1, 2, 4}, {2}, {2, 1, 1, 1}};
+  std::vector<vec_t> vs;
+  for (const auto& in : inputs) vs.emplace_back(std::allocator_arg, a, in);
+
+  for (std::size_t i = 0; i != inputs.size(); ++i) {
+    for (std::size_t j = 0; j != inputs.size(); ++j) {
+      REQUIRE((vs[i] == vs[j]) == (inputs[i] == inputs[j]));
+      REQUIRE((vs[i] < vs[j]) == (inputs[i] < inputs[j]));
+    }
+  }
+
+  for (auto& v : vs) v.destroy(a);
+}
+
+TEST_CASE("small_vector_short_keys_do_not_allocate",
+          "[small_vector, dependent_lib]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using vec_allocator = dependent_lib::allocator_adaptor<
+      dependent::stats_allocator<char, tag>>;
+  using vec_t = dependent_lib::small_vector<char, vec_allocator>;
+
+  vec_allocator a;
+  std::vector<vec_t> vs;
+  for (auto w : {"a", "of", "the", "word", "short", "inline", "1234567"})
+    vs.emplace_back(std::allocator_arg, a, std::string(w));
+  REQUIRE(stats::total_allocated_size() == 0);
+
+  vs.emplace_back(std::allocator_arg, a, std::string("12345678"));
+  REQUIRE(stats::total_allocated_size() != 0);
+
+  std::set<vec_t, dependent_lib::span_less> s(vs.begin(), vs.end());
+  REQUIRE(s.size() == 8);
+  REQUIRE(s.find(std::string_view("word")) != s.end());
+  REQUIRE(s.find(std::string_view("12345678")) != s.end());
+
+  for (auto& v : vs) v.destroy(a);
+}
+
+}  // namespace
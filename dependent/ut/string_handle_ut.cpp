@@ -0,0 +1,86 @@
+#include "dependent/string_handle.h"
+
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/transparent.h"
+
+namespace {
+
+TEST_CASE("string_handle_concepts", "[string_handle, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using str_t = dependent_lib::string_handle<char, vec_allocator>;
+  static_assert(sizeof(str_t) == 16, "");
+  static_assert(std::is_trivially_copyable<str_t>::value, "");
+  static_assert(dependent_lib::DependentType<str_t, vec_allocator>, "");
+  static_assert(std::uses_allocator<str_t, vec_allocator>::value, "");
+
+  using set_allocator = dependent_lib::allocator_adaptor<std::allocator<str_t>>;
+  std::set<str_t, std::less<>, set_allocator> s;
+  s.emplace(std::string("a long string that is allocated"));
+  s.emplace(std::string("short"));
+  REQUIRE(s.size() == 2);
+  REQUIRE(!s.begin()->is_inline());
+}
+
+TEST_CASE("string_handle_modes", "[string_handle, dependent_lib]") {
+  using str_t = dependent_lib::string_handle<char, std::allocator<char>>;
+  std::allocator<char> a;
+
+  for (std::size_t n = 0; n != 40; ++n) {
+    std::string s(n, 'a');
+    for (std::size_t i = 0; i != n; ++i) s[i] += i % 26;
+
+    str_t v(std::allocator_arg, a, s);
+    REQUIRE(v.is_inline() == (n <= str_t::inline_capacity));
+    REQUIRE(v.size() == n);
+    auto sp = v.as_span();
+    REQUIRE(std::string_view(sp.begin(), sp.size()) == s);
+    REQUIRE(std::hash<str_t>{}(v) ==
+            dependent_lib::span_hash{}(std::string_view(s)));
+    v.destroy(a);
+  }
+}
+
+template <typename Char>
+void check_comparison() {
+  using str_t = dependent_lib::string_handle<Char, std::allocator<Char>>;
+  std::allocator<Char> a;
+
+  // Few distinct elements, including the extremes, and sizes around the
+  // prefix and the inline capacity.
+  const Char alphabet[] = {0, 1, 'a', static_cast<Char>(0x7f),
+                           static_cast<Char>(0x80), static_cast<Char>(0xff)};
+  std::mt19937 gen(7);
+  std::vector<std::vector<Char>> inputs;
+  for (int i = 0; i != 300; ++i) {
+    std::vector<Char> in(gen() % 16);
+    for (auto& c : in) c = alphabet[gen() % std::size(alphabet)];
+    inputs.push_back(in);
+  }
+
+  std::vector<str_t> vs;
+  for (const auto& in : inputs) vs.emplace_back(std::allocator_arg, a, in);
+
+  for (std::size_t i = 0; i != inputs.size(); ++i) {
+    for (std::size_t j = 0; j != inputs.size(); ++j) {
+      REQUIRE((vs[i] == vs[j]) == (inputs[i] == inputs[j]));
+      REQUIRE((vs[i] < vs[j]) == (inputs[i] < inputs[j]));
+    }
+  }
+
+  for (auto& v : vs) v.destroy(a);
+}
+
+TEST_CASE("string_handle_comparison", "[string_handle, dependent_lib]") {
+  check_comparison<char>();
+  check_comparison<signed char>();
+  check_comparison<unsigned char>();
+}
+
+}  // namespace
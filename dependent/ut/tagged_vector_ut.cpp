@@ -0,0 +1,74 @@
+#include "dependent/tagged_vector.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/transparent.h"
+
+namespace {
+
+TEST_CASE("tagged_vector_concepts", "[tagged_vector, dependent_lib]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using vec_t = dependent_lib::tagged_vector<char, vec_allocator>;
+  static_assert(sizeof(vec_t) == sizeof(void*), "");
+  static_assert(std::is_trivially_copyable<vec_t>::value, "");
+  static_assert(dependent_lib::DependentType<vec_t, vec_allocator>, "");
+  static_assert(std::uses_allocator<vec_t, vec_allocator>::value, "");
+
+  using set_allocator = dependent_lib::allocator_adaptor<std::allocator<vec_t>>;
+  std::set<vec_t, std::less<>, set_allocator> s;
+  s.emplace(std::string("abc"));
+  s.emplace(std::string(100'000, 'x'));
+  REQUIRE(s.size() == 2);
+}
+
+TEST_CASE("tagged_vector_sizes", "[tagged_vector, dependent_lib]") {
+  using vec_t = dependent_lib::tagged_vector<short, std::allocator<short>>;
+  std::allocator<short> a;
+
+  for (std::size_t n : {0, 1, 7, 256, 65534, 65535, 65536, 100'000}) {
+    std::vector<short> in(n);
+    for (std::size_t i = 0; i != n; ++i) in[i] = static_cast<short>(i);
+
+    vec_t v(std::allocator_arg, a, in);
+    REQUIRE(v.is_small() == (n < 0xffff));
+    REQUIRE(v.size() == n);
+    auto sp = v.as_span();
+    REQUIRE(std::equal(sp.begin(), sp.end(), in.begin(), in.end()));
+    REQUIRE(std::hash<vec_t>{}(v) == dependent_lib::span_hash{}(in));
+    v.destroy(a);
+  }
+}
+
+TEST_CASE("tagged_vector_comparison", "[tagged_vector, dependent_lib]") {
+  using vec_t = dependent_lib::tagged_vector<char, std::allocator<char>>;
+  std::allocator<char> a;
+
+  std::vector<std::string> inputs = {"",    "a",   "ab",
+                                     "abc", "abd", "b",
+                                     std::string(70'000, 'a'),
+                                     std::string(70'000, 'b')};
+  std::vector<vec_t> vs;
+  for (const auto& in : inputs) vs.emplace_back(std::allocator_arg, a, in);
+
+  for (std::size_t i = 0; i != inputs.size(); ++i) {
+    for (std::size_t j = 0; j != inputs.size(); ++j) {
+      REQUIRE((vs[i] == vs[j]) == (inputs[i] == inputs[j]));
+      REQUIRE((vs[i] < vs[j]) == (inputs[i] < inputs[j]));
+    }
+  }
+
+  std::stable_sort(vs.begin(), vs.end(), [](const vec_t& x, const vec_t& y) {
+    return x.size() < y.size();
+  });
+  REQUIRE(vs.front().size() == 0);
+  REQUIRE(vs.back().size() == 70'000);
+
+  for (auto& v : vs) v.destroy(a);
+}
+
+}  // namespace
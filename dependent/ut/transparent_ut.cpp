@@ -0,0 +1,145 @@
+#include "dependent/transparent.h"
+
+#include <array>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catch/catch.h"
+
+#include "dependent/flat_hash_set.h"
+#include "dependent/utils/stats_allocator.h"
+
+namespace {
+
+constexpr short arr1[] = {1, 2, 6, 2, 6};
+
+TEST_CASE("transparent_projections", "[transparent, dependent_lib]") {
+  using vec_t = dependent_lib::vector<short, std::allocator<short>>;
+  std::allocator<short> a;
+  vec_t v(std::allocator_arg, a, std::begin(arr1), std::end(arr1));
+
+  std::vector<short> same(std::begin(arr1), std::end(arr1));
+  std::array<short, 5> same_array = {1, 2, 6, 2, 6};
+  dependent_lib::span<const short> same_span{same.data(),
+                                             same.data() + same.size()};
+
+  dependent_lib::span_hash h;
+  dependent_lib::span_equal_to eq;
+  REQUIRE(h(v) == h(same));
+  REQUIRE(h(v) == h(arr1));
+  REQUIRE(h(v) == h(same_array));
+  REQUIRE(h(v) == h(same_span));
+  REQUIRE(eq(v, same));
+  REQUIRE(eq(same_span, v));
+  REQUIRE(eq(arr1, v));
+
+  same.back() = 7;
+  dependent_lib::span_less less;
+  REQUIRE(!eq(v, same));
+  REQUIRE(less(v, same));
+  REQUIRE(!less(same, v));
+  REQUIRE(!less(v, arr1));
+
+  v.destroy(a);
+}
+
+TEST_CASE("transparent_string_views", "[transparent, dependent_lib]") {
+  using vec_t = dependent_lib::vector<char, std::allocator<char>>;
+  std::allocator<char> a;
+  std::string s = "abc";
+  vec_t v(std::allocator_arg, a, s);
+
+  future_std_stubs::string_view stub_sv{s.data(), s.data() + s.size()};
+
+  dependent_lib::span_hash h;
+  REQUIRE(h(v) == h(std::string_view("abc")));
+  REQUIRE(h(v) == h(s));
+  REQUIRE(h(v) == h(stub_sv));
+  REQUIRE(dependent_lib::span_equal_to{}(v, std::string_view("abc")));
+  REQUIRE(dependent_lib::span_less{}(std::string_view("ab"), v));
+
+  // Literals don't include their NUL.
+  REQUIRE(h(v) == h("abc"));
+  REQUIRE(dependent_lib::span_equal_to{}(v, "abc"));
+  REQUIRE(!dependent_lib::span_less{}(v, "abc"));
+  REQUIRE(!dependent_lib::span_less{}("abc", v));
+  const char buffer[8] = "abc";
+  REQUIRE(dependent_lib::span_equal_to{}(buffer, v));
+
+  v.destroy(a);
+}
+
+TEST_CASE("transparent_set_lookup_by_literal", "[transparent, dependent_lib]") {
+  using vec_t = dependent_lib::vector<char, std::allocator<char>>;
+  std::allocator<char> a;
+  std::set<vec_t, dependent_lib::span_less> s;
+  for (const std::string x : {"ab", "abc", "abcd"})
+    s.emplace(std::allocator_arg, a, x);
+
+  auto it = s.find("abc");
+  REQUIRE(it != s.end());
+  REQUIRE(it == s.find(std::string("abc")));
+  REQUIRE(s.find("abce") == s.end());
+  REQUIRE(s.count("ab") == 1);
+
+  for (auto x : s) x.destroy(a);
+}
+
+TEST_CASE("transparent_cached_hash", "[transparent, dependent_lib]") {
+  using vec_t = dependent_lib::vector<char, std::allocator<char>,
+                                      dependent_lib::hashed_header<>>;
+  std::allocator<char> a;
+  vec_t v(std::allocator_arg, a, std::string("abc"));
+
+  static_assert(dependent_lib::detail::HasFullCachedHashImpl<vec_t>::value,
+                "");
+  REQUIRE(dependent_lib::span_hash{}(v) == v.cached_hash());
+  REQUIRE(dependent_lib::span_hash{}(v) ==
+          dependent_lib::span_hash{}(std::string_view("abc")));
+
+  v.destroy(a);
+}
+
+TEST_CASE("transparent_set_lookup_does_not_allocate",
+          "[transparent, dependent_lib]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+  using vec_allocator = dependent_lib::allocator_adaptor<
+      dependent::stats_allocator<char, tag>>;
+  using vec_t = dependent_lib::vector<char, vec_allocator>;
+  using set_allocator = dependent_lib::allocator_adaptor<
+      dependent::stats_allocator<vec_t, tag>>;
+
+  std::set<vec_t, dependent_lib::span_less, set_allocator> s;
+  s.emplace(std::string("abc"));
+  s.emplace(std::string("def"));
+
+  auto allocated = stats::total_allocated_size();
+  REQUIRE(s.find(std::string_view("abc")) != s.end());
+  REQUIRE(s.find(std::string_view("xyz")) == s.end());
+  REQUIRE(s.count(std::string("def")) == 1);
+  REQUIRE(stats::total_allocated_size() == allocated);
+}
+
+TEST_CASE("transparent_flat_hash_set_lookup", "[transparent, flat_hash_set]") {
+  using vec_allocator = dependent_lib::allocator_adaptor<std::allocator<char>>;
+  using vec_t = dependent_lib::vector<char, vec_allocator>;
+  using set_allocator = dependent_lib::allocator_adaptor<std::allocator<vec_t>>;
+  using set_t =
+      dependent_lib::flat_hash_set<vec_t, dependent_lib::span_hash,
+                                   dependent_lib::span_equal_to, set_allocator>;
+
+  set_t s;
+  for (int i = 0; i < 100; ++i) s.emplace(std::to_string(i));
+
+  REQUIRE(s.contains(std::string_view("42")));
+  REQUIRE(!s.contains(std::string_view("100")));
+  REQUIRE(s.count(std::string("7")) == 1);
+  REQUIRE(s.erase(std::string_view("7")) == 1);
+  REQUIRE(!s.contains(std::string_view("7")));
+  REQUIRE(s.size() == 99);
+}
+
+}  // namespace
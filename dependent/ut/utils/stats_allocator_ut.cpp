@@ -1,8 +1,10 @@
 #include "dependent/utils/stats_allocator.h"
 
 #include <memory>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
@@ -90,3 +92,19 @@ TEST_CASE("std_unordered_map_of_strings", "[stats_allocator, dependent_lib]") {
   // reading libc++ code is quite hard in this area, so I'm not sure.
   REQUIRE(stats::allocated_size_for_t<char>() == entry.capacity() + 1);
 }
+
+TEST_CASE("write_stats", "[stats_allocator, dependent_lib]") {
+  struct tag {};
+  using stats = dependent::area_stats<tag>;
+
+  dependent::stats_containers<tag>::vector<int64_t> v(10);
+  std::size_t sum = 0;
+  stats::for_each([&](std::string_view, std::size_t size) { sum += size; });
+  REQUIRE(sum == stats::total_allocated_size());
+
+  std::ostringstream os;
+  dependent::write_stats(os, "area", stats{});
+  REQUIRE(os.str() == std::string("area.") + typeid(int64_t).name() + " " +
+                          std::to_string(v.capacity() * sizeof(int64_t)) +
+                          "\n");
+}
@@ -3,7 +3,10 @@
 
 #include <cstddef>
 #include <memory>
+#include <ostream>
+#include <string_view>
 #include <type_traits>
+#include <typeinfo>
 #include <utility>
 
 // Wrapper for std::allocator to collect some memory stats.
@@ -19,10 +22,11 @@ namespace detail {
 // Stats for a single type are linked into an intrusive list for an area.
 struct memory_stats_for_t {
   std::size_t allocated_size = 0u;
+  const char* name;
   const memory_stats_for_t* next = nullptr;
 
-  memory_stats_for_t(const memory_stats_for_t*& list)
-      : next{std::exchange(list, this)} {}
+  memory_stats_for_t(const memory_stats_for_t*& list, const char* name)
+      : name{name}, next{std::exchange(list, this)} {}
 };
 
 }  // namespace detail
@@ -39,7 +43,7 @@ class area_stats {
 
   template <typename T>
   static t_stats& stats_for_t() {
-    static t_stats r{stats_list()};
+    static t_stats r{stats_list(), typeid(T).name()};
     return r;
   }
 
@@ -57,6 +61,15 @@ class area_stats {
     return res;
   }
 
+  // Calls f(name, allocated_size) for every type allocated in the area. Names
+  // are the implementation defined typeid names.
+  template <typename F>
+  static void for_each(F f) {
+    for (const t_stats* head = stats_list(); head; head = head->next) {
+      f(std::string_view{head->name}, head->allocated_size);
+    }
+  }
+
   template <typename T>
   static void report_allocation(std::size_t size) {
     stats_for_t<T>().allocated_size += size;
@@ -101,6 +114,17 @@ class stats_allocator {
   }
 };
 
+// Writes a "prefix.name size" line for every entry of stats: an area_stats
+// or anything else with a for_each(f(name, size)), like the stats of a dense
+// allocator. Dumps of std containers and arenas can go to the same stream.
+template <typename Stats>
+void write_stats(std::ostream& os, std::string_view prefix,
+                 const Stats& stats) {
+  stats.for_each([&](std::string_view name, std::size_t size) {
+    os << prefix << '.' << name << ' ' << size << '\n';
+  });
+}
+
 }  // namespace dependent
 
 #endif  // _DEPENDEDENT_UTILS_STATS_ALLOCATOR_H_